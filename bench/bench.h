@@ -0,0 +1,47 @@
+/**
+ * @file bench.h
+ * @author Flynn Harrison
+ * @brief Microbenchmarks for the hot path kernels. Runs on a Linux host
+ * (bench_host.c, driven by run_bench.py) or on target with cycle counters
+ * (bench_target.c, enable BENCHMARK_ON_BOOT in menuconfig).
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+typedef struct {
+	const char *name;
+	double nsPerOp;
+	double cyclesPerOp;			// 0 when the platform has no cycle counter
+	double bytesPerOp;			// Heap bytes allocated per op
+	double allocsPerOp;
+} bench_result_t;
+
+typedef void (*bench_report_t)(const bench_result_t *result);
+
+/**
+ * @brief Runs every benchmark, calling report once per kernel
+ * 
+ * @param report 
+ */
+void bench_run_all(bench_report_t report);
+
+/**
+ * @brief Runs every benchmark and logs the results (target only)
+ * 
+ */
+void bench_target_run(void);
+
+// Provided by the platform (bench_host.c or bench_target.c)
+uint64_t bench_now_ns(void);
+uint64_t bench_cycles(void);
+void bench_alloc_snapshot(uint64_t *bytes, uint64_t *count);
+
+#endif
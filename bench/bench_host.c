@@ -0,0 +1,111 @@
+/**
+ * @file bench_host.c
+ * @author Flynn Harrison
+ * @brief Linux host driver for the benchmarks, see run_bench.py
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "esp_gap_ble_api.h"
+#include "esp_timer.h"
+
+// Linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc so allocations can be counted
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static uint64_t s_allocBytes;
+static uint64_t s_allocCount;
+
+void *__wrap_malloc(size_t size)
+{
+	s_allocBytes += size;
+	s_allocCount++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+	s_allocBytes += n * size;
+	s_allocCount++;
+	return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	s_allocBytes += size;
+	s_allocCount++;
+	return __real_realloc(ptr, size);
+}
+
+uint64_t bench_now_ns(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+int64_t esp_timer_get_time(void)
+{
+	return (int64_t)(bench_now_ns() / 1000);
+}
+
+uint64_t bench_cycles(void)
+{
+	return 0;
+}
+
+void bench_alloc_snapshot(uint64_t *bytes, uint64_t *count)
+{
+	*bytes = s_allocBytes;
+	*count = s_allocCount;
+}
+
+uint8_t *esp_ble_resolve_adv_data(uint8_t *adv_data, uint8_t type, uint8_t *length)
+{
+	uint8_t *p = adv_data;
+	uint8_t len;
+
+	if (adv_data == NULL)
+	{
+		*length = 0;
+		return NULL;
+	}
+
+	len = *p;
+	while (len != 0 && p - adv_data < ESP_BLE_ADV_DATA_LEN_MAX + ESP_BLE_SCAN_RSP_DATA_LEN_MAX)
+	{
+		if (p[1] == type)
+		{
+			*length = len - 1;
+			return p + 2;
+		}
+		p += len + 1;
+		len = *p;
+	}
+
+	*length = 0;
+	return NULL;
+}
+
+static void report(const bench_result_t *result)
+{
+	printf("BENCH %-22s %10.1f ns/op %8.1f B/op %6.2f allocs/op\n", result->name, result->nsPerOp, result->bytesPerOp, result->allocsPerOp);
+	fflush(stdout);
+}
+
+int main(void)
+{
+	bench_run_all(report);
+	return 0;
+}
@@ -0,0 +1,458 @@
+/**
+ * @file bench_kernels.c
+ * @author Flynn Harrison
+ * @brief Hot path kernels run against a synthetic but realistic advertisement
+ * corpus: our own tags mixed with iBeacon, Eddystone, AltBeacon and phone traffic
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "beaconBLE.h"
+#include "beaconList.h"
+#include "record.h"
+#include "compress.h"
+#include "globalQueues.h"
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#endif
+
+#define CORPUS_SIZE     256
+#define ADV_BUFF_SIZE   62          // scan_rst.ble_adv, advert followed by scan response
+#define BENCH_REPS      5           // Best of
+#define BENCH_TARGET_NS 20000000ULL // Aim for ~20 ms per rep
+#define PIPELINE_STACK  4096
+
+typedef struct {
+	uint8_t adv[ADV_BUFF_SIZE];
+	uint8_t len;
+} bench_adv_t;
+
+typedef void (*bench_kernel_t)(uint32_t iterations);
+
+static bench_adv_t s_corpus[CORPUS_SIZE];
+static bench_adv_t s_ourTags[CORPUS_SIZE];
+static int s_ourTagCount;
+static volatile uint32_t s_sink;
+static uint32_t s_rng = 0x2545F491;
+
+static uint32_t rng(void)
+{
+	// xorshift32, fixed seed so every run sees the same corpus
+	s_rng ^= s_rng << 13;
+	s_rng ^= s_rng >> 17;
+	s_rng ^= s_rng << 5;
+	return s_rng;
+}
+
+static void put(bench_adv_t *a, const uint8_t *bytes, size_t n)
+{
+	memcpy(&a->adv[a->len], bytes, n);
+	a->len += n;
+}
+
+static void put_random(bench_adv_t *a, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		a->adv[a->len++] = rng();
+	}
+}
+
+static void make_fh(bench_adv_t *a, uint8_t id)
+{
+	const uint8_t head[] = { 0x02, 0x01, 0x06, 0x02, 0x0A, 0x03, 0x03, 0x19, 0x00, 0x02,
+		0x05, 0xFF, 0xFF, 0xFF, 'F', 'H', 0x05, 0x16, 'F', 'Y', 'P' };
+	put(a, head, sizeof(head));
+	a->adv[a->len++] = id;
+}
+
+static void make_ibeacon(bench_adv_t *a)
+{
+	const uint8_t head[] = { 0x02, 0x01, 0x06, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15 };
+	put(a, head, sizeof(head));
+	put_random(a, 16 + 2 + 2);
+	a->adv[a->len++] = 0xC5;
+}
+
+static void make_eddystone_uid(bench_adv_t *a)
+{
+	const uint8_t head[] = { 0x02, 0x01, 0x06, 0x03, 0x03, 0xAA, 0xFE, 0x17, 0x16, 0xAA, 0xFE, 0x00, 0xEE };
+	put(a, head, sizeof(head));
+	put_random(a, 10 + 6);
+	a->adv[a->len++] = 0x00;
+	a->adv[a->len++] = 0x00;
+}
+
+static void make_altbeacon(bench_adv_t *a)
+{
+	const uint8_t head[] = { 0x02, 0x01, 0x06, 0x1B, 0xFF, 0x18, 0x01, 0xBE, 0xAC };
+	put(a, head, sizeof(head));
+	put_random(a, 20);
+	a->adv[a->len++] = 0xC5;
+	a->adv[a->len++] = 0x00;
+}
+
+static void make_noise(bench_adv_t *a)
+{
+	// Phones and laptops, manufacturer data of assorted lengths plus a name
+	const uint8_t head[] = { 0x02, 0x01, 0x1A };
+	uint8_t msdLen = 3 + rng() % 20;
+	put(a, head, sizeof(head));
+	a->adv[a->len++] = msdLen + 1;
+	a->adv[a->len++] = 0xFF;
+	put_random(a, msdLen);
+	a->adv[a->len++] = 0x05;
+	a->adv[a->len++] = 0x09;
+	put(a, (const uint8_t *)"Pix7", 4);
+}
+
+static void build_corpus(void)
+{
+	uint32_t pick;
+
+	for (int i = 0; i < CORPUS_SIZE; i++)
+	{
+		pick = rng() % 100;
+		if (pick < 25)
+		{
+			make_fh(&s_corpus[i], rng() % 40);
+			s_ourTags[s_ourTagCount++] = s_corpus[i];
+		}
+		else if (pick < 45)
+		{
+			make_ibeacon(&s_corpus[i]);
+		}
+		else if (pick < 60)
+		{
+			make_eddystone_uid(&s_corpus[i]);
+		}
+		else if (pick < 70)
+		{
+			make_altbeacon(&s_corpus[i]);
+		}
+		else
+		{
+			make_noise(&s_corpus[i]);
+		}
+	}
+}
+
+// ---- Kernels ----
+
+static void k_is_beacon(uint32_t iterations)
+{
+	uint32_t hits = 0;
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		hits += ble_is_beacon(s_corpus[i % CORPUS_SIZE].adv);
+	}
+	s_sink = hits;
+}
+
+static void k_classify(uint32_t iterations)
+{
+	ble_beacon_reading_t reading;
+	uint32_t hits = 0;
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		hits += ble_beacon_classify(s_corpus[i % CORPUS_SIZE].adv, s_corpus[i % CORPUS_SIZE].len, &reading) != BLE_BEACON_FORMAT_NONE;
+	}
+	s_sink = hits;
+}
+
+static void k_decode(uint32_t iterations)
+{
+	ble_beacon_recived_t rd;
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		ble_beacon_decode(s_ourTags[i % s_ourTagCount].adv, &rd);
+		s_sink = rd.uuid_32b[3];
+	}
+}
+
+static void k_dedup(uint32_t iterations)
+{
+	struct list_s heard = { 0 };
+	uint32_t hits = 0;
+	uint32_t id;
+
+	// One scan worth of tags, about half of the lookups are repeats
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		if ((i & 63) == 0)
+		{
+			heard = (const struct list_s){ 0 };
+		}
+		id = s_ourTags[i % s_ourTagCount].adv[s_ourTags[i % s_ourTagCount].len - 1];
+		if (isInList(&heard, id))
+		{
+			hits++;
+		}
+		else
+		{
+			addToList(&heard, id);
+		}
+	}
+	s_sink = hits;
+}
+
+static void fill_reading(ble_beacon_recived_t *rd, uint32_t i)
+{
+	memcpy(rd->uuid_32b, "FYP", 3);
+	rd->uuid_32b[3] = i % 40;
+	rd->rssi = -50 - (int8_t)(i % 40);
+	rd->TxPower = 3;
+	rd->packetGroup = 1000 + i / 40;
+	rd->deviceID = 1;
+	rd->format = BLE_BEACON_FORMAT_FH;
+	rd->event = BLE_BEACON_EVENT_SIGHTING;
+}
+
+static void k_query_string(uint32_t iterations)
+{
+	char buf[80];
+	ble_beacon_recived_t rd;
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		fill_reading(&rd, i);
+		s_sink = record_query_sighting(buf, sizeof(buf), &rd);
+	}
+}
+
+static void k_pack_record(uint32_t iterations)
+{
+	uint8_t buf[RECORD_SIGHTING_LEN];
+	ble_beacon_recived_t rd;
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		fill_reading(&rd, i);
+		s_sink = record_pack_sighting(buf, sizeof(buf), &rd);
+	}
+}
+
+static void k_compress_batch(uint32_t iterations)
+{
+	// A full datagram payload, one op compresses the whole batch
+	static uint8_t raw[1 + 27 * RECORD_SIGHTING_LEN];
+	static uint8_t out[sizeof(raw)];
+	ble_beacon_recived_t rd;
+	size_t len;
+
+	raw[0] = 27;
+	len = 1;
+	for (uint32_t r = 0; r < 27; r++)
+	{
+		fill_reading(&rd, r * 3);
+		len += record_pack_sighting(&raw[len], sizeof(raw) - len, &rd);
+	}
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		s_sink = compress_lz(raw, len, out, sizeof(out));
+	}
+}
+
+static void k_handoff(uint32_t iterations)
+{
+	ble_beacon_recived_t in;
+	ble_beacon_recived_t out;
+
+	// Send then receive one reading, as the GAP callback and uploader do, through the
+	// handoff and the backlog it is collected into (reset again before the tasks start)
+	beaconHandoffInit();
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		fill_reading(&in, i);
+		beaconHandoffSend(&in);
+		beaconHandoffReceive(&out);
+		s_sink = out.rssi;
+	}
+}
+
+#if defined(ESP_PLATFORM)
+static void k_handoff_queue(uint32_t iterations)
+{
+	static uint8_t storage[10 * sizeof(ble_beacon_recived_t)];
+	static StaticQueue_t buffer;
+	QueueHandle_t queue;
+	ble_beacon_recived_t in;
+	ble_beacon_recived_t out;
+
+	// The FreeRTOS queue alone, as k_handoff uses on single core targets
+	queue = xQueueCreateStatic(10, sizeof(ble_beacon_recived_t), storage, &buffer);
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		fill_reading(&in, i);
+		xQueueSend(queue, &in, 0);
+		xQueueReceive(queue, &out, 0);
+		s_sink = out.rssi;
+	}
+	vQueueDelete(queue);
+}
+
+// Scan side of the pipeline kernels, decodes our tags and hands them off like the GAP callback
+static StackType_t s_producerStack[PIPELINE_STACK];
+static StaticTask_t s_producerTask;
+static volatile uint32_t s_producerLeft;
+
+static void pipeline_producer(void *arg)
+{
+	ble_beacon_recived_t rd;
+	uint32_t i = 0;
+
+	while (s_producerLeft > 0)
+	{
+		ble_beacon_decode(s_ourTags[i++ % s_ourTagCount].adv, &rd);
+		while (!beaconHandoffSend(&rd))
+		{
+			// Uploader behind, same as a full handoff during a scan but nothing is lost here
+			taskYIELD();
+		}
+		s_producerLeft--;
+	}
+
+	// Deleted by the kernel once suspended, so the static TCB is free again before the next rep
+	xTaskNotifyGive((TaskHandle_t)arg);
+	vTaskSuspend(NULL);
+}
+
+/**
+ * @brief Readings per second through decode, the handoff and the upload side record
+ * formatting, with the scan side on producerCore and the upload side on this task's core.
+ * One op is one reading decoded and handed off.
+ * 
+ * @param iterations 
+ * @param producerCore 
+ */
+static void pipeline(uint32_t iterations, BaseType_t producerCore)
+{
+	char buf[80];
+	ble_beacon_recived_t rd;
+	TaskHandle_t producer;
+
+	beaconHandoffInit();
+	s_producerLeft = iterations;
+	producer = xTaskCreateStaticPinnedToCore(pipeline_producer, "Bench scan", PIPELINE_STACK, xTaskGetCurrentTaskHandle(),
+		uxTaskPriorityGet(NULL), s_producerStack, &s_producerTask, producerCore);
+
+	while (s_producerLeft > 0 || beaconHandoffWaiting() > 0)
+	{
+		if (beaconHandoffReceive(&rd))
+		{
+			s_sink = record_query_sighting(buf, sizeof(buf), &rd);
+		}
+		else
+		{
+			taskYIELD();
+		}
+	}
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	while (eTaskGetState(producer) != eSuspended)
+	{
+		vTaskDelay(1);
+	}
+	vTaskDelete(producer);
+}
+
+static void k_pipeline_one_core(uint32_t iterations)
+{
+	// Single core layout, scan and upload take turns
+	pipeline(iterations, xPortGetCoreID());
+}
+
+#if !defined(CONFIG_FREERTOS_UNICORE)
+static void k_pipeline_two_cores(uint32_t iterations)
+{
+	// Dual core layout, scanning on one core while the other uploads
+	pipeline(iterations, !xPortGetCoreID());
+}
+#endif
+#endif
+
+// ---- Harness ----
+
+static void run(const char *name, bench_kernel_t kernel, bench_report_t report)
+{
+	bench_result_t result = { .name = name };
+	uint64_t start, elapsed, cycles, bytes0, bytes1, count0, count1;
+	uint32_t iterations = 64;
+	double ns;
+
+	// Warm up and scale iterations until one rep takes long enough to time
+	for (;;)
+	{
+		start = bench_now_ns();
+		kernel(iterations);
+		elapsed = bench_now_ns() - start;
+		if (elapsed >= BENCH_TARGET_NS / 4 || iterations >= (1u << 28))
+		{
+			break;
+		}
+		iterations *= 2;
+	}
+	iterations = elapsed > 0 ? (uint32_t)((double)iterations * BENCH_TARGET_NS / elapsed) + 1 : iterations;
+
+	result.nsPerOp = -1;
+	for (int rep = 0; rep < BENCH_REPS; rep++)
+	{
+		bench_alloc_snapshot(&bytes0, &count0);
+		cycles = bench_cycles();
+		start = bench_now_ns();
+		kernel(iterations);
+		elapsed = bench_now_ns() - start;
+		cycles = bench_cycles() - cycles;
+		bench_alloc_snapshot(&bytes1, &count1);
+
+		ns = (double)elapsed / iterations;
+		if (result.nsPerOp < 0 || ns < result.nsPerOp)
+		{
+			result.nsPerOp = ns;
+			result.cyclesPerOp = (double)cycles / iterations;
+		}
+		result.bytesPerOp = (double)(bytes1 - bytes0) / iterations;
+		result.allocsPerOp = (double)(count1 - count0) / iterations;
+	}
+
+	report(&result);
+}
+
+void bench_run_all(bench_report_t report)
+{
+	if (s_ourTagCount == 0)
+	{
+		build_corpus();
+	}
+
+	run("ble_is_beacon", k_is_beacon, report);
+	run("ble_beacon_decode", k_decode, report);
+	run("ble_beacon_classify", k_classify, report);
+	run("dedup_lookup", k_dedup, report);
+	run("record_query_string", k_query_string, report);
+	run("record_pack", k_pack_record, report);
+	run("compress_batch", k_compress_batch, report);
+	run("handoff", k_handoff, report);
+#if defined(ESP_PLATFORM)
+	run("handoff_queue", k_handoff_queue, report);
+	// Single against dual core throughput, compare the two ns/op on S3 or ESP32
+	run("pipeline_one_core", k_pipeline_one_core, report);
+#if !defined(CONFIG_FREERTOS_UNICORE)
+	run("pipeline_two_cores", k_pipeline_two_cores, report);
+#endif
+#endif
+}
@@ -0,0 +1,49 @@
+/**
+ * @file bench_target.c
+ * @author Flynn Harrison
+ * @brief On target driver for the benchmarks, built into the app when
+ * BENCHMARK_ON_BOOT is set and run from app_main before any task starts
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "bench.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "hal/cpu_hal.h"
+
+static const char TAG[] = "Bench";
+
+uint64_t bench_now_ns(void)
+{
+	return (uint64_t)esp_timer_get_time() * 1000;
+}
+
+uint64_t bench_cycles(void)
+{
+	// 32 bit counter, fine for reps of a few tens of ms
+	return cpu_hal_get_cycle_count();
+}
+
+void bench_alloc_snapshot(uint64_t *bytes, uint64_t *count)
+{
+	// No allocation hook on target, report net heap growth instead
+	*bytes = heap_caps_get_total_size(MALLOC_CAP_8BIT) - heap_caps_get_free_size(MALLOC_CAP_8BIT);
+	*count = 0;
+}
+
+static void report(const bench_result_t *result)
+{
+	ESP_LOGI(TAG, "BENCH %-22s %10.1f ns/op %8.1f cycles/op %8.1f B/op", result->name, result->nsPerOp, result->cyclesPerOp, result->bytesPerOp);
+}
+
+void bench_target_run(void)
+{
+	ESP_LOGI(TAG, "Running benchmarks");
+	bench_run_all(report);
+}
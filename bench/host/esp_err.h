@@ -0,0 +1,8 @@
+/* Host shim for the benchmarks, only what the kernels use */
+#pragma once
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK      0
+#define ESP_FAIL    -1
@@ -0,0 +1,22 @@
+/* Host shim for the benchmarks, only what beaconBLE.h and the decoders use */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define ESP_BLE_ADV_DATA_LEN_MAX        31
+#define ESP_BLE_SCAN_RSP_DATA_LEN_MAX   31
+#define ESP_BLE_ADV_FLAG_GEN_DISC       (0x01 << 1)
+#define ESP_BLE_ADV_FLAG_BREDR_NOT_SPT  (0x01 << 2)
+
+typedef enum { BLE_SCAN_TYPE_PASSIVE, BLE_SCAN_TYPE_ACTIVE } esp_ble_scan_type_t;
+typedef enum { BLE_ADDR_TYPE_PUBLIC } esp_ble_addr_type_t;
+typedef enum { BLE_SCAN_FILTER_ALLOW_ALL } esp_ble_scan_filter_t;
+typedef enum { BLE_SCAN_DUPLICATE_DISABLE, BLE_SCAN_DUPLICATE_ENABLE } esp_ble_scan_duplicate_t;
+
+typedef int esp_gap_ble_cb_event_t;
+typedef union { int unused; } esp_ble_gap_cb_param_t;
+typedef void (*esp_gap_ble_cb_t)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+
+/* Same walk as the Bluedroid implementation, see bench_host.c */
+uint8_t *esp_ble_resolve_adv_data(uint8_t *adv_data, uint8_t type, uint8_t *length);
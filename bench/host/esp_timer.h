@@ -0,0 +1,5 @@
+/* Host shim for the benchmarks, implemented in bench_host.c */
+#pragma once
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,7 @@
+/* Host shim for the benchmarks, single threaded so critical sections compile out */
+#pragma once
+#include <stdint.h>
+
+typedef int portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    0
@@ -0,0 +1,4 @@
+/* Host shim for the benchmarks, every optional module is configured out */
+#pragma once
+
+#define CONFIG_BEACON_QUEUE_LEN 20
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Builds and runs the hot path microbenchmarks on the host and compares them
+against the stored baseline.
+
+    python3 bench/run_bench.py                    # compare against baseline.json
+    python3 bench/run_bench.py --update-baseline  # store this run as the baseline
+
+Exits non-zero if any kernel is slower than the baseline by more than the
+threshold, or allocates where the baseline did not. Baselines are machine
+specific, refresh them when changing the machine the numbers come from.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BENCH = os.path.join(ROOT, "bench")
+MAIN = os.path.join(ROOT, "main")
+BASELINE = os.path.join(BENCH, "baseline.json")
+
+# Kernels under test, they must not depend on anything beyond bench/host
+SOURCES = [
+    os.path.join(BENCH, "bench_kernels.c"),
+    os.path.join(BENCH, "bench_host.c"),
+    os.path.join(MAIN, "beaconDecode.c"),
+    os.path.join(MAIN, "beaconList.c"),
+    os.path.join(MAIN, "record.c"),
+    os.path.join(MAIN, "compress.c"),
+    os.path.join(MAIN, "spscRing.c"),
+    os.path.join(MAIN, "globalQueues.c"),
+]
+
+LINE = re.compile(r"^BENCH\s+(\S+)\s+([\d.]+) ns/op\s+([\d.]+) B/op\s+([\d.]+) allocs/op")
+
+
+def build(cc, out):
+    cmd = [cc, "-std=gnu11", "-O2", "-Wall",
+           "-I", os.path.join(BENCH, "host"), "-I", BENCH, "-I", MAIN,
+           "-o", out] + SOURCES + ["-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc"]
+    subprocess.run(cmd, check=True)
+
+
+def run(binary, runs):
+    """Best ns/op of several runs, the host is rarely quiet."""
+    results = {}
+    for _ in range(runs):
+        proc = subprocess.run([binary], check=True, capture_output=True, text=True)
+        for line in proc.stdout.splitlines():
+            m = LINE.match(line)
+            if not m:
+                continue
+            now = {
+                "ns_per_op": float(m.group(2)),
+                "bytes_per_op": float(m.group(3)),
+                "allocs_per_op": float(m.group(4)),
+            }
+            best = results.get(m.group(1))
+            if best is None or now["ns_per_op"] < best["ns_per_op"]:
+                results[m.group(1)] = now
+    for name, r in results.items():
+        print("%-22s %10.1f ns/op %8.1f B/op %6.2f allocs/op" %
+              (name, r["ns_per_op"], r["bytes_per_op"], r["allocs_per_op"]))
+    return results
+
+
+def compare(results, baseline, threshold):
+    failed = False
+    print("\n%-22s %12s %12s %8s" % ("kernel", "baseline ns", "now ns", "ratio"))
+    for name, now in results.items():
+        base = baseline.get(name)
+        if base is None:
+            print("%-22s %12s %12.1f %8s" % (name, "-", now["ns_per_op"], "new"))
+            continue
+        ratio = now["ns_per_op"] / base["ns_per_op"] if base["ns_per_op"] else 1.0
+        flag = ""
+        if ratio > threshold:
+            flag = "  SLOWER"
+            failed = True
+        if now["allocs_per_op"] > base["allocs_per_op"]:
+            flag += "  ALLOCATES"
+            failed = True
+        print("%-22s %12.1f %12.1f %8.2f%s" % (name, base["ns_per_op"], now["ns_per_op"], ratio, flag))
+    return failed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    parser.add_argument("--threshold", type=float, default=1.5,
+                        help="fail if ns/op exceeds baseline by this factor (default 1.5)")
+    parser.add_argument("--runs", type=int, default=3, help="runs to take the best of (default 3)")
+    parser.add_argument("--update-baseline", action="store_true")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        binary = os.path.join(tmp, "bench")
+        build(args.cc, binary)
+        results = run(binary, args.runs)
+
+    if args.update_baseline:
+        with open(BASELINE, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("\nBaseline written to %s" % os.path.relpath(BASELINE, ROOT))
+        return 0
+
+    if not os.path.exists(BASELINE):
+        print("\nNo baseline yet, run with --update-baseline")
+        return 0
+
+    with open(BASELINE) as f:
+        baseline = json.load(f)
+    return 1 if compare(results, baseline, args.threshold) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -18,6 +18,8 @@
 
 #include "esp_event.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_wpa2.h"
 #include "esp_err.h"
@@ -28,9 +30,18 @@
 #include "lwip/sys.h"
 #include "lwip/err.h"
 
+#if defined(CONFIG_LIVE_TABLE_ENABLE)
+#include "liveServer.h"
+#endif
+#if defined(CONFIG_SCAN_SLOTTED)
+#include "timeSlot.h"
+#endif
+
 // Setting set by config
-#define WIFI_MAX_RETRY 10000     //CONFIG_ESP_MAXIMUM_RETRY
-#define WIFI_RECONNECT_DELAY 5000
+#define WIFI_MAX_RETRY CONFIG_WIFI_MAXIMUM_RETRY
+#define WIFI_RECONNECT_BASE_MS CONFIG_WIFI_RECONNECT_BASE_MS      // First retry delay, doubled every attempt
+#define WIFI_RECONNECT_MAX_MS CONFIG_WIFI_RECONNECT_MAX_MS        // Cap on the backoff delay
+#define WIFI_RETRY_COOLDOWN_MS CONFIG_WIFI_RETRY_COOLDOWN_MS      // Pause after WIFI_MAX_RETRY before starting over
 
 #define LISTEN_INTERVAL 3
 //#define PS_MODE WIFI_PS_MIN_MODEM
@@ -45,16 +56,58 @@ extern uint8_t ca_pem_end[]   asm("_binary_ca_pem_end");
 // Bit 0 - is wifi connected
 // bit 1 - connection failed after max attempt 
 static EventGroupHandle_t s_wifi_event_group;
+#if defined(CONFIG_STATIC_ALLOCATION)
+static StaticEventGroup_t s_wifi_event_group_buffer;
+#endif
 #define WIFI_CONNECTED_BIT  0x0001
 #define WIFI_FAILED_BIT     0x0002
 
+// Reconnection is driven by a one shot timer so the default event loop is never blocked
+static esp_timer_handle_t s_reconnect_timer;
+static volatile int s_retry_num = 0;
+
 // Info logging
 static const char *TAG = "WiFi station";
 
+/**
+ * @brief Timer callback, runs in the esp_timer task
+ * 
+ * @param arg 
+ */
+static void reconnect_cb(void *arg)
+{
+    ESP_LOGI(TAG, "Retrying to connect to wifi attempt %d.", s_retry_num);
+    esp_wifi_connect();
+}
+
+/**
+ * @brief Exponential backoff with jitter. Returns a delay in the upper half of
+ * min(WIFI_RECONNECT_BASE_MS * 2^attempt, WIFI_RECONNECT_MAX_MS) so receivers that
+ * drop together do not all retry together
+ * 
+ * @param attempt number of retries already made
+ * @return uint32_t delay in ms
+ */
+static uint32_t reconnect_delay_ms(int attempt)
+{
+    uint32_t delay = WIFI_RECONNECT_BASE_MS;
+
+    while (attempt-- > 0 && delay < WIFI_RECONNECT_MAX_MS)
+    {
+        delay <<= 1;
+    }
+    if (delay > WIFI_RECONNECT_MAX_MS)
+    {
+        delay = WIFI_RECONNECT_MAX_MS;
+    }
+
+    return delay / 2 + esp_random() % (delay / 2 + 1);
+}
+
 static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
-    static int s_retry_num = 0;
-    
+    uint32_t delay;
+
     ESP_LOGI(TAG, "Event handler called with base=%s, event_id=%d", event_base, event_id);
 
     // Attempt to connect wifi station to AP
@@ -66,12 +119,21 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         }
         else if (event_id == WIFI_EVENT_STA_DISCONNECTED)
         {
-            xEventGroupSetBits(s_wifi_event_group, WIFI_FAILED_BIT);
             xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
-            vTaskDelay(pdMS_TO_TICKS(WIFI_RECONNECT_DELAY));
-            esp_wifi_connect();
+
+            // Give up after WIFI_MAX_RETRY, WiFiManageTask restarts the sequence after a cooldown
+            if (s_retry_num >= WIFI_MAX_RETRY)
+            {
+                ESP_LOGE(TAG, "Failed to connect after %d attempts", s_retry_num);
+                xEventGroupSetBits(s_wifi_event_group, WIFI_FAILED_BIT);
+                return;
+            }
+
+            delay = reconnect_delay_ms(s_retry_num);
             s_retry_num++;
-            ESP_LOGI(TAG, "Retrying to connect to wifi attempt %d.", s_retry_num);
+            esp_timer_stop(s_reconnect_timer);
+            ESP_ERROR_CHECK(esp_timer_start_once(s_reconnect_timer, (uint64_t)delay * 1000));
+            ESP_LOGI(TAG, "Reconnect attempt %d in %u ms", s_retry_num, (unsigned int)delay);
         }
     }
 
@@ -83,6 +145,15 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
         xEventGroupClearBits(s_wifi_event_group, WIFI_FAILED_BIT);
         ESP_LOGI(TAG, "Connected with ip: %d.%d.%d.%d", IP2STR(&event->ip_info.ip));
+
+#if defined(CONFIG_LIVE_TABLE_ENABLE)
+        // Keeps running across reconnects, only the first call starts it
+        live_server_start();
+#endif
+#if defined(CONFIG_SCAN_SLOTTED)
+        // SNTP keeps polling on its own after this
+        time_slot_start();
+#endif
     }
 }
 
@@ -94,7 +165,18 @@ void WiFiManageTask(void * pvParam)
 
     // WiFi/LwIP init phase
     // Init wifi event group
+#if defined(CONFIG_STATIC_ALLOCATION)
+    s_wifi_event_group = xEventGroupCreateStatic(&s_wifi_event_group_buffer);
+#else
     s_wifi_event_group = xEventGroupCreate();
+#endif
+
+    // Reconnect timer
+    const esp_timer_create_args_t reconnect_timer_args = {
+        .callback = &reconnect_cb,
+        .name = "wifi reconnect"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&reconnect_timer_args, &s_reconnect_timer));
 
     // LwIP through netif init
     ESP_ERROR_CHECK(esp_netif_init());
@@ -155,20 +237,25 @@ void WiFiManageTask(void * pvParam)
     // Connection and 'Got IP' phase
     for ( ;; )
     {
-        // Wait for connection (or fail) from the event handler
+        // Wait for the event handler to run out of retries
         xEventGroupWaitBits(s_wifi_event_group,
             WIFI_FAILED_BIT,
-            pdFALSE,
+            pdTRUE,
             pdFALSE,
             portMAX_DELAY);  
 
-        vTaskDelay(pdMS_TO_TICKS(5000));
+        vTaskDelay(pdMS_TO_TICKS(WIFI_RETRY_COOLDOWN_MS));
+
+        ESP_LOGI(TAG, "Restarting connection attempts");
+        s_retry_num = 0;
+        esp_wifi_connect();
     }
 
 
     // free event handler and event group
     ESP_ERROR_CHECK(esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, instance_got_ip));
     ESP_ERROR_CHECK(esp_event_handler_instance_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, instance_any_id));
+    esp_timer_delete(s_reconnect_timer);
     vEventGroupDelete(s_wifi_event_group);
     vTaskDelete(NULL);
 }
@@ -180,4 +267,9 @@ void WiFiWaitUntillConnected()
             pdFALSE,
             pdFALSE,
             portMAX_DELAY);
+}
+
+int WiFiGetRetryCount()
+{
+    return s_retry_num;
 }
\ No newline at end of file
@@ -23,4 +23,11 @@ void WiFiManageTask(void * pvParam);
 
 void WiFiWaitUntillConnected();
 
+/**
+ * @brief Number of reconnection attempts since the last successful connection
+ * 
+ * @return int 
+ */
+int WiFiGetRetryCount();
+
 #endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+/**
+ * @file allowlist.c
+ * @author Flynn Harrison
+ * @brief Provisioned beacon allowlist
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "allowlist.h"
+
+#include <string.h>
+#include <stdatomic.h>
+
+#include "esp_log.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+#define ALLOWLIST_MAX CONFIG_ALLOWLIST_MAX
+
+// Power of two at least twice ALLOWLIST_MAX, keeps the load factor at or under 1/2
+#define ALLOWLIST_SLOTS_FOR(n) ((n) <= 8 ? 16 : (n) <= 32 ? 64 : (n) <= 128 ? 256 : (n) <= 512 ? 1024 : 2048)
+#define ALLOWLIST_SLOTS ALLOWLIST_SLOTS_FOR(ALLOWLIST_MAX)
+
+#define ALLOWLIST_EMPTY 0			// Key 0 is tracked by hasZero instead
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME        16777619u
+
+typedef struct {
+	uint32_t keys[ALLOWLIST_SLOTS];
+	uint16_t positions[ALLOWLIST_SLOTS];	// Provisioned position of the key in the same slot
+	uint32_t mask;					// Slots in use - 1, sized to the list rather than ALLOWLIST_MAX
+	uint32_t shift;					// 32 - log2(mask + 1)
+	uint32_t maxProbe;				// Longest probe sequence of any key, bounds a lookup
+	uint32_t count;
+	uint32_t orderHash;
+	uint16_t zeroPosition;
+	bool hasZero;
+} allowlist_index_t;
+
+static const char TAG[] = "Allowlist";
+
+// Built once at boot before the GAP callback is registered, read only after that
+static allowlist_index_t s_index;
+static atomic_uint_fast32_t s_rejected;
+
+static inline uint32_t allowlist_hash(uint32_t key, uint32_t shift)
+{
+	// Fibonacci hashing, the top bits of the product are well mixed
+	return (key * 2654435761u) >> shift;
+}
+
+static void allowlist_hash_order(allowlist_index_t *index, uint32_t key)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		index->orderHash = (index->orderHash ^ ((key >> (8 * i)) & 0xFF)) * FNV_PRIME;
+	}
+}
+
+static void allowlist_build(allowlist_index_t *index, const uint32_t *keys, size_t count)
+{
+	uint32_t slots = 16;
+	uint32_t bits = 4;
+	uint32_t slot;
+	uint32_t probe;
+
+	while (slots < 2 * count)
+	{
+		slots <<= 1;
+		bits++;
+	}
+
+	memset(index, 0, sizeof(*index));
+	index->mask = slots - 1;
+	index->shift = 32 - bits;
+	index->orderHash = FNV_OFFSET_BASIS;
+
+	// Positions count unique keys in the order they were provisioned
+	for (size_t i = 0; i < count; i++)
+	{
+		if (keys[i] == ALLOWLIST_EMPTY)
+		{
+			if (!index->hasZero)
+			{
+				index->zeroPosition = index->count++;
+				index->hasZero = true;
+				allowlist_hash_order(index, keys[i]);
+			}
+			continue;
+		}
+
+		slot = allowlist_hash(keys[i], index->shift);
+		for (probe = 0; index->keys[(slot + probe) & index->mask] != ALLOWLIST_EMPTY; probe++)
+		{
+			if (index->keys[(slot + probe) & index->mask] == keys[i])
+			{
+				break;
+			}
+		}
+		if (index->keys[(slot + probe) & index->mask] == keys[i])
+		{
+			continue;	// Duplicate
+		}
+
+		index->keys[(slot + probe) & index->mask] = keys[i];
+		index->positions[(slot + probe) & index->mask] = index->count++;
+		allowlist_hash_order(index, keys[i]);
+		if (probe > index->maxProbe)
+		{
+			index->maxProbe = probe;
+		}
+	}
+}
+
+esp_err_t allowlist_init(void)
+{
+	static uint32_t keys[ALLOWLIST_MAX];
+	nvs_handle_t handle;
+	size_t len = sizeof(keys);
+	esp_err_t ret;
+
+	atomic_init(&s_rejected, 0);
+
+	ret = nvs_open(ALLOWLIST_NVS_NAMESPACE, NVS_READONLY, &handle);
+	if (ret == ESP_OK)
+	{
+		ret = nvs_get_blob(handle, ALLOWLIST_NVS_KEY, keys, &len);
+		nvs_close(handle);
+	}
+
+	if (ret == ESP_ERR_NVS_NOT_FOUND)
+	{
+		ESP_LOGW(TAG, "No allowlist provisioned, every beacon is accepted");
+		allowlist_build(&s_index, NULL, 0);
+		return ESP_OK;
+	}
+	if (ret != ESP_OK)
+	{
+		// Includes ESP_ERR_NVS_INVALID_LENGTH, more IDs than ALLOWLIST_MAX
+		ESP_LOGE(TAG, "Failed to load allowlist: %s", esp_err_to_name(ret));
+		allowlist_build(&s_index, NULL, 0);
+		return ret;
+	}
+
+	allowlist_build(&s_index, keys, len / sizeof(uint32_t));
+	ESP_LOGI(TAG, "Loaded %u IDs (%u slots, at most %u probes)", (unsigned int)allowlist_count(),
+		(unsigned int)(s_index.mask + 1), (unsigned int)(s_index.maxProbe + 1));
+	return ESP_OK;
+}
+
+/**
+ * @brief Probes the index for a key
+ * 
+ * @param index
+ * @param key
+ * @return int provisioned position or ALLOWLIST_NOT_FOUND
+ */
+static int allowlist_lookup(const allowlist_index_t *index, uint32_t key)
+{
+	uint32_t slot;
+
+	if (key == ALLOWLIST_EMPTY)
+	{
+		return index->hasZero ? index->zeroPosition : ALLOWLIST_NOT_FOUND;
+	}
+
+	slot = allowlist_hash(key, index->shift);
+	for (uint32_t probe = 0; probe <= index->maxProbe; probe++)
+	{
+		if (index->keys[(slot + probe) & index->mask] == key)
+		{
+			return index->positions[(slot + probe) & index->mask];
+		}
+	}
+
+	return ALLOWLIST_NOT_FOUND;
+}
+
+bool allowlist_contains(uint32_t key)
+{
+	if (s_index.count == 0)
+	{
+		return true;
+	}
+
+	if (allowlist_lookup(&s_index, key) == ALLOWLIST_NOT_FOUND)
+	{
+		atomic_fetch_add_explicit(&s_rejected, 1, memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+
+int allowlist_position(uint32_t key)
+{
+	return allowlist_lookup(&s_index, key);
+}
+
+uint32_t allowlist_order_hash(void)
+{
+	return s_index.orderHash;
+}
+
+uint32_t allowlist_count(void)
+{
+	return s_index.count;
+}
+
+uint32_t allowlist_rejected(void)
+{
+	return atomic_load(&s_rejected);
+}
@@ -0,0 +1,78 @@
+/**
+ * @file allowlist.h
+ * @author Flynn Harrison
+ * @brief Provisioned beacon allowlist. IDs are stored in NVS and loaded at boot into
+ * an open addressing hash index, so the GAP callback can drop foreign tags with a
+ * bounded number of probes.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef ALLOWLIST_H
+#define ALLOWLIST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+// NVS location, written by tools/allowlist.py
+#define ALLOWLIST_NVS_NAMESPACE "allowlist"
+#define ALLOWLIST_NVS_KEY       "ids"		// Blob of uint32_t beacon keys (ble_beacon_key()), little endian
+
+#define ALLOWLIST_NOT_FOUND -1
+
+/**
+ * @brief Loads the allowlist from NVS and builds the index. An empty or missing
+ * allowlist lets every beacon through. Call after nvs_flash_init() and before
+ * scanning starts, the index is not changed after that.
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t allowlist_init(void);
+
+/**
+ * @brief Checks a beacon key against the allowlist (GAP callback)
+ * 
+ * @param key ble_beacon_key()
+ * @return true allowed, or nothing provisioned
+ * @return false 
+ */
+bool allowlist_contains(uint32_t key);
+
+/**
+ * @brief Position of a beacon in the provisioned order, duplicates skipped. This is
+ * its slot in fingerprint records (see fingerprint.h).
+ * 
+ * @param key ble_beacon_key()
+ * @return int 0 based position or ALLOWLIST_NOT_FOUND (always when nothing is provisioned)
+ */
+int allowlist_position(uint32_t key);
+
+/**
+ * @brief FNV-1a hash of the provisioned keys in order (little endian bytes), lets the
+ * server check its ordering matches the receiver's
+ * 
+ * @return uint32_t 
+ */
+uint32_t allowlist_order_hash(void);
+
+/**
+ * @brief IDs in the allowlist
+ * 
+ * @return uint32_t 
+ */
+uint32_t allowlist_count(void);
+
+/**
+ * @brief Sightings rejected since boot
+ * 
+ * @return uint32_t 
+ */
+uint32_t allowlist_rejected(void);
+
+#endif
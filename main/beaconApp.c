@@ -26,28 +26,51 @@
 #include "esp_bt_main.h"
 #include "esp_bt_defs.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "beaconBLE.h"
+#include "beaconList.h"
 #include "globalQueues.h"
 #include "databaseApp.h"
 #include "WiFi.h"
-
-// Frequency between adverise pulses
-#define CYCLE_RATE_MS_RX 1000*8 // How frequently the RX app runs
-#define RX_RECIVE_TIME	1000*2  // How long it waits for a response
-
-#define DEVICEID 1				// Reciver device ID ------- will be subject to change in format
-
-#define BEACON_LIST_SIZE 20
+#include "memReport.h"
+#include "presence.h"
+#include "trace.h"
+#include "profile.h"
+#include "pacer.h"
+#include "scanWindow.h"
+#include "params.h"
+#include "sdkconfig.h"
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+#include "rssiHist.h"
+#endif
+#if defined(CONFIG_ALLOWLIST_ENABLE)
+#include "allowlist.h"
+#endif
+#if defined(CONFIG_LIVE_TABLE_ENABLE)
+#include "liveTable.h"
+#endif
+#if defined(CONFIG_SCAN_SLOTTED)
+#include "timeSlot.h"
+#endif
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+#include "fingerprint.h"
+#endif
+
+// Cycle and receive times, scan interval and window, the backlog length and the
+// device ID are runtime parameters (see params.h)
+#define SCAN_STOP_TIMEOUT_MS 200	// Wait for the stop complete event
+
+// Task notification bits from the GAP callback to the scan task
+#define SCAN_NOTIFY_ALL_HEARD   (1 << 0)
+#define SCAN_NOTIFY_STOPPED     (1 << 1)
+
+#define MEM_REPORT_CYCLES CONFIG_MEM_REPORT_CYCLES	// Cycles between memory reports, 0 to disable
 
 // ESP_LOGx tag
 static const char TAG[] = "beacon module";
 
-struct list_s {
-  uint32_t list[BEACON_LIST_SIZE];
-  size_t  size;
-};
-
 static esp_ble_scan_params_t ble_scan_params = {
     .scan_type              = SCN_PARAM_SCAN_TYPE,
     .own_addr_type          = SCN_PARAM_OWM_ADDR_TYPE,
@@ -57,15 +80,30 @@ static esp_ble_scan_params_t ble_scan_params = {
     .scan_duplicate         = SCN_PARAM_SCAN_DUPLICATE
 };
 
-static uint8_t isInList(struct list_s * beaconList, uint8_t id);
 static void esp_gap_cb(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+static void logFormatCounts(void);
+static void logPresence(void);
+static void logBacklog(void);
+static void logPacer(void);
+static void logScanWindow(void);
+static void logTimeSlot(void);
+static scan_window_reason_t scanUntilDone(void);
+static bool waitForNotify(uint32_t bit, uint32_t timeoutMs);
+static void applyParams(uint32_t changed);
+static void checkQuietPeriod(void);
+
+static TaskHandle_t s_rxTask = NULL;
+static int8_t s_deviceID;		// Reciver device ID, only changed between scans
 
 void vBeaconRXTask(void *pvParameters)
 {
 	TickType_t xLastWakeTick;
 	esp_err_t ret;
+	unsigned int cycle = 0;
 	//uint32_t scan_duration = 3;
 
+	s_rxTask = xTaskGetCurrentTaskHandle();
+
 	ret = ble_start();
 	if (ret){
 		vTaskDelete(NULL);
@@ -77,30 +115,93 @@ void vBeaconRXTask(void *pvParameters)
 	}
 
 	// RX logic
+	ble_scan_params.scan_interval = params_get(PARAM_SCAN_INTERVAL);
+	ble_scan_params.scan_window = params_get(PARAM_SCAN_WINDOW);
 	ret = esp_ble_gap_set_scan_params(&ble_scan_params);
 	if (ret){
 		ESP_LOGE(TAG, "%s Failed to configure scan params, error: %s", __func__, esp_err_to_name(ret));
 		vTaskDelete(NULL);
 	}
+	checkQuietPeriod();
+	applyParams(PARAM_BIT(PARAM_QUEUE_LEN) | PARAM_BIT(PARAM_DEVICE_ID));
 
+	// Receivers that power up together (after an outage) would otherwise scan and
+	// upload in lockstep for as long as they stay up
+	vTaskDelay(pdMS_TO_TICKS(pacer_phase_ms(params_get(PARAM_CYCLE_MS))));
 
 	ESP_LOGI(TAG, "%s Started RX application\n", __func__);
 	xLastWakeTick = xTaskGetTickCount();
 	for(;;){
 		// Wait for next cycle to start before unblocking
-		vTaskDelayUntil(&xLastWakeTick, pdMS_TO_TICKS(CYCLE_RATE_MS_RX));
+#if defined(CONFIG_SCAN_SLOTTED)
+		if (time_slot_synced()){
+			// Same boundary on every receiver, so scan windows line up
+			time_slot_wait_cycle(params_get(PARAM_CYCLE_MS));
+			xLastWakeTick = xTaskGetTickCount();
+		} else {
+			vTaskDelayUntil(&xLastWakeTick, pdMS_TO_TICKS(params_get(PARAM_CYCLE_MS)));
+		}
+#else
+		vTaskDelayUntil(&xLastWakeTick, pdMS_TO_TICKS(params_get(PARAM_CYCLE_MS)));
+#endif
+		PROFILE_BEGIN(PROFILE_CYCLE);
 
+		// Values pushed by the collector take effect here, never mid scan
+		applyParams(params_apply());
+
+#if !defined(CONFIG_UPLOAD_TRANSPORT_UART)
 		// Wait till Wifi is connected or wait for reconnection
+		PROFILE_BEGIN(PROFILE_WIFI_WAIT);
 		WiFiWaitUntillConnected();
+		PROFILE_END(PROFILE_WIFI_WAIT);
+#endif
 
 		ESP_LOGD(TAG, "Starting scan");
+		PROFILE_BEGIN(PROFILE_SCAN_START);	// Ends in the GAP callback
+		PROFILE_BEGIN(PROFILE_SCAN);
+		scan_window_begin(esp_timer_get_time(), params_get(PARAM_RX_MS));
+		xTaskNotifyWait(0, UINT32_MAX, NULL, 0);		// Clear on exit, drops a stop complete that came in after the last scan gave up on it
+#if defined(CONFIG_SCAN_SLOTTED)
+		if (time_slot_synced()){
+			time_slot_scan_starting();
+		}
+#endif
 		esp_ble_gap_start_scanning(0);
-		vTaskDelay(pdMS_TO_TICKS(RX_RECIVE_TIME));
+		scanUntilDone();
 		esp_ble_gap_stop_scanning();
+
+		// Radio is off once the stop completes, the time saved goes to upload and sleep
+		if (!waitForNotify(SCAN_NOTIFY_STOPPED, SCAN_STOP_TIMEOUT_MS)){
+			ESP_LOGW(TAG, "No scan stop complete event");
+		}
+		PROFILE_END(PROFILE_SCAN);
 		ESP_LOGD(TAG, "Finish Scan");
 
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+		// No more scan results, uploaded with the sightings from this scan
+		fingerprint_end();
+#endif
+
 		// Send to database
+#if defined(CONFIG_FREERTOS_UNICORE)
 		databaseContact();
+#else
+		// Upload task on the other core takes it from here
+		databaseNotify();
+#endif
+
+		if (MEM_REPORT_CYCLES > 0 && ++cycle % MEM_REPORT_CYCLES == 0){
+			memReportLog();
+			logFormatCounts();
+			logPresence();
+			logBacklog();
+			logPacer();
+			logScanWindow();
+			logTimeSlot();
+		}
+
+		PROFILE_END(PROFILE_CYCLE);
+		PROFILE_CYCLE_END();
 	}
 
 	vTaskDelete(NULL);
@@ -127,64 +228,85 @@ static void esp_gap_cb(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *par
 
 	// Indicate scan start operation success status
 	case ESP_GAP_BLE_SCAN_START_COMPLETE_EVT:
+		PROFILE_END(PROFILE_SCAN_START);
 		ret = param->scan_start_cmpl.status;
 		if (ret != ESP_BT_STATUS_SUCCESS){
 			ESP_LOGE(TAG, "%s Scan failed to start, error: %s", __func__, esp_err_to_name(ret));
 		} else {
 			packetGroup++;
       heardBeacons = (const struct list_s){ 0 };
-			ESP_LOGD(TAG, "%s Started scan successfull", __func__);
+			scan_window_started(esp_timer_get_time());
+			TRACE_POINT(TRACE_SCAN_START, packetGroup, 0, 0);
 		}
 		break;
 
 	// When one scan result ready, the event comes each time
 	case ESP_GAP_BLE_SCAN_RESULT_EVT:{
 		esp_ble_gap_cb_param_t *scan_result = param;
-		ESP_LOGD(TAG, "%s Scan results event", __func__);
+		// Runs for every advertisement heard, no formatting here (see trace.h)
+		TRACE_POINT(TRACE_SCAN_RESULT, scan_result->scan_rst.search_evt, scan_result->scan_rst.adv_data_len + scan_result->scan_rst.scan_rsp_len, 0);
     
     if (scan_result->scan_rst.search_evt == ESP_GAP_SEARCH_INQ_RES_EVT)
     {
-      if(ble_is_beacon(scan_result->scan_rst.ble_adv))
+      // Filled out here and copied into the queue, no allocation per reading
+      ble_beacon_reading_t reading;
+
+      if(ble_beacon_classify(scan_result->scan_rst.ble_adv, scan_result->scan_rst.adv_data_len + scan_result->scan_rst.scan_rsp_len, &reading) != BLE_BEACON_FORMAT_NONE)
       {
-				// Allocate data structure memory 		REMEMBER TO FREE!!!
-				ble_beacon_recived_t *received_data;
-				received_data = pvPortMalloc(sizeof(ble_beacon_recived_t));
-				if (received_data == NULL)
-        {
-					ESP_LOGE(TAG, "Failed to allocate memory to received_data");
+#if defined(CONFIG_ALLOWLIST_ENABLE)
+				// Foreign and spoofed tags go no further
+				if (!allowlist_contains(ble_beacon_key(&reading.base)))
+				{
+					TRACE_POINT(TRACE_BEACON_REJECTED, 0, ble_beacon_key(&reading.base), 0);
 					break;
 				}
+#endif
+				ble_beacon_recived_t received_data = reading.base;
 
 				// Fillout data
-				ble_beacon_decode(scan_result->scan_rst.ble_adv, received_data);
-				received_data->rssi = scan_result->scan_rst.rssi;
-				received_data->packetGroup = packetGroup;
-				received_data->deviceID = DEVICEID;
+				received_data.rssi = scan_result->scan_rst.rssi;
+				received_data.packetGroup = packetGroup;
+				received_data.deviceID = s_deviceID;
+				received_data.event = BLE_BEACON_EVENT_SIGHTING;
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+				// Every scan result counts, even ones deduplicated below
+				rssi_hist_add(&received_data);
+#endif
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+				fingerprint_add(&received_data);
+#endif
+#if defined(CONFIG_LIVE_TABLE_ENABLE)
+				live_table_update(&received_data, esp_timer_get_time());
+#endif
 
         // Check if beacon has already been discovered in this scan
-        if (isInList(&heardBeacons, received_data->uuid_32b[3]))
+        if (isInList(&heardBeacons, ble_beacon_key(&received_data)))
         {
-          vPortFree(received_data);
+          TRACE_POINT(TRACE_BEACON_DUPLICATE, 0, ble_beacon_key(&received_data), 0);
           break;
         }
         else
         {
-          heardBeacons.list[heardBeacons.size++] = received_data->uuid_32b[3];
+          addToList(&heardBeacons, ble_beacon_key(&received_data));
         }
 
+				// Last of the beacons heard recently, no need to keep the radio on
+				if (scan_window_heard(ble_beacon_key(&received_data), esp_timer_get_time()))
+				{
+					xTaskNotify(s_rxTask, SCAN_NOTIFY_ALL_HEARD, eSetBits);
+				}
+
 				// Add to queue 
-				if(xQueueSend(beaconQueueHandle, &received_data, 0) != pdTRUE)
+				if(!beaconHandoffSend(&received_data))
         {
-					ESP_LOGE(TAG, "Failed to add memory to beaconQueueHandle queue");
-					vPortFree(received_data);
+					TRACE_POINT(TRACE_HANDOFF_FULL, 0, ble_beacon_key(&received_data), 0);
+					ESP_LOGE(TAG, "Failed to add reading to beacon queue");
 					break;
 				}
 
-				// Share over serial
-				ESP_LOGD(TAG, "~~Beacon Found~~\n");
-				ESP_LOGD(TAG, "UUID_32b: %02x %02x %02x %02x\n",received_data->uuid_32b[0], received_data->uuid_32b[1], received_data->uuid_32b[2], received_data->uuid_32b[3]);
-				ESP_LOGD(TAG, "TxPower: %d dBm\n",received_data->TxPower);
-				ESP_LOGD(TAG, "RSSI: %d dBm\n",received_data->rssi);
+				// Share over serial, formatted later by the trace task
+				TRACE_POINT(TRACE_BEACON_FOUND, received_data.rssi, ble_beacon_key(&received_data), received_data.format << 8 | received_data.TxPower);
 			}
     }
 		break;
@@ -194,8 +316,11 @@ static void esp_gap_cb(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *par
         if ((ret = param->scan_stop_cmpl.status) != ESP_BT_STATUS_SUCCESS){
             ESP_LOGE(TAG, "%s Scan stop failed: %s", __func__ , esp_err_to_name(ret));
         } else {
-            ESP_LOGD(TAG, "%s Stoped scan successfully", __func__);
+            // Radio on time and what ended the scan, traced there
+            scan_window_stopped(esp_timer_get_time());
         }
+        // Scan task waits for this either way
+        xTaskNotify(s_rxTask, SCAN_NOTIFY_STOPPED, eSetBits);
         break;
 
 	default:
@@ -203,15 +328,184 @@ static void esp_gap_cb(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *par
 	}
 }
 
-static uint8_t isInList(struct list_s * beaconList, uint8_t id)
+static void logFormatCounts(void)
 {
-  for (int i = 0; i < beaconList->size; i++)
-  {
-    if (id == beaconList->list[i])
-    {
-      return 1;
-    }
-  }
+	uint32_t counts[BLE_BEACON_FORMAT_COUNT];
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+	fingerprint_stats_t fpStats;
+#endif
+
+	ble_beacon_get_format_counts(counts);
+	for (int f = BLE_BEACON_FORMAT_NONE + 1; f < BLE_BEACON_FORMAT_COUNT; f++){
+		ESP_LOGI(TAG, "%-14s %u matches", ble_beacon_format_name(f), (unsigned int)counts[f]);
+	}
+#if defined(CONFIG_ALLOWLIST_ENABLE)
+	ESP_LOGI(TAG, "Allowlist: %u IDs, %u sightings rejected", (unsigned int)allowlist_count(), (unsigned int)allowlist_rejected());
+#endif
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+	fingerprint_get_stats(&fpStats);
+	ESP_LOGI(TAG, "Fingerprints: %u built, %u scans empty, %u replaced before upload, %u results past slot %d",
+		(unsigned int)fpStats.built, (unsigned int)fpStats.empty, (unsigned int)fpStats.replaced,
+		(unsigned int)fpStats.outside, FINGERPRINT_BEACONS);
+#endif
+}
+
+static void logPresence(void)
+{
+#if defined(CONFIG_PRESENCE_EVENTS)
+	presence_stats_t stats;
+
+	presence_get_stats(&stats);
+	ESP_LOGI(TAG, "Presence: %u sightings -> %u enter, %u exit, %u heartbeat (%u not delivered). %u tracked, %u present, %u evicted",
+		(unsigned int)stats.sightings, (unsigned int)stats.enters, (unsigned int)stats.exits, (unsigned int)stats.heartbeats,
+		(unsigned int)stats.undelivered, (unsigned int)stats.tracked, (unsigned int)stats.present, (unsigned int)stats.evictions);
+#endif
+}
+
+static void logBacklog(void)
+{
+	beaconHandoff_stats_t stats;
+
+	beaconHandoffGetStats(&stats);
+	ESP_LOGI(TAG, "Backlog: %u readings (%u dropped at the handoff), %u coalesced, %u evicted, %u uploaded (%u put back). Age avg %u ms, max %u ms, longest wait %u ms",
+		(unsigned int)stats.received, (unsigned int)stats.dropped, (unsigned int)stats.coalesced, (unsigned int)stats.evicted, (unsigned int)stats.delivered,
+		(unsigned int)stats.requeued,
+		(unsigned int)(stats.delivered ? stats.totalAgeUs / stats.delivered / 1000 : 0),
+		(unsigned int)(stats.maxAgeUs / 1000), (unsigned int)(stats.maxWaitUs / 1000));
+#if defined(CONFIG_LIVE_TABLE_ENABLE)
+	ESP_LOGI(TAG, "Live table: %u snapshot retries", (unsigned int)live_table_retries());
+#endif
+}
+
+static void logPacer(void)
+{
+	pacer_stats_t stats;
+
+	pacer_get_stats(&stats);
+	ESP_LOGI(TAG, "Pacer: %u requests, %u rate limited (%u ms waited), %u server hold offs (last %u ms)",
+		(unsigned int)stats.requests, (unsigned int)stats.waits, (unsigned int)stats.waitedMs,
+		(unsigned int)stats.holdOffs, (unsigned int)stats.lastHoldOffMs);
+}
+
+static void logTimeSlot(void)
+{
+#if defined(CONFIG_SCAN_SLOTTED)
+	time_slot_stats_t stats;
+
+	time_slot_get_stats(&stats);
+	if (stats.syncs == 0){
+		ESP_LOGI(TAG, "Slots: clock not set yet, cycle free running");
+		return;
+	}
+
+	// The clock step at each sync is the bound on skew between receivers, the wake up
+	// latency is only this receiver's own
+	ESP_LOGI(TAG, "Slots: %u syncs, clock step last %d ms, max %u ms. %u aligned scans, %u boundaries missed, wake up latency last %d ms, avg %u ms, max %u ms. %u uploads, %u skipped past their slot",
+		(unsigned int)stats.syncs, (int)stats.lastStepMs, (unsigned int)stats.maxStepMs,
+		(unsigned int)stats.cycles, (unsigned int)stats.missedCycles, (int)stats.lastWakeMs,
+		(unsigned int)(stats.cycles ? stats.totalWakeMs / stats.cycles : 0), (unsigned int)stats.maxWakeMs,
+		(unsigned int)stats.uploads, (unsigned int)stats.lateUploads);
+#endif
+}
+
+/**
+ * @brief Keeps the scan running until scanWindow says it can stop
+ * 
+ * @return scan_window_reason_t 
+ */
+static scan_window_reason_t scanUntilDone(void)
+{
+	scan_window_reason_t reason;
+
+	while ((reason = scan_window_check(esp_timer_get_time())) == SCAN_WINDOW_CONTINUE){
+		// Woken early by the GAP callback once every expected beacon is heard
+		waitForNotify(SCAN_NOTIFY_ALL_HEARD, scan_window_wait_ms(esp_timer_get_time()));
+	}
+
+	return reason;
+}
+
+/**
+ * @brief Waits for a notification bit from the GAP callback, other bits are left pending
+ * 
+ * @param bit 
+ * @param timeoutMs 
+ * @return true bit was set
+ * @return false timed out
+ */
+static bool waitForNotify(uint32_t bit, uint32_t timeoutMs)
+{
+	TickType_t start = xTaskGetTickCount();
+	TickType_t timeout = pdMS_TO_TICKS(timeoutMs) + 1;		// Round up, never a zero wait
+	TickType_t elapsed;
+	uint32_t bits;
+
+	while ((elapsed = xTaskGetTickCount() - start) < timeout){
+		if (xTaskNotifyWait(0, bit, &bits, timeout - elapsed) == pdTRUE && (bits & bit)){
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void logScanWindow(void)
+{
+	scan_window_stats_t stats;
+
+	scan_window_get_stats(&stats);
+	if (stats.scans == 0){
+		return;
+	}
+
+	ESP_LOGI(TAG, "Scan: %u scans, %u ended all heard, %u quiet, %u at max. Last %u ms (%u expected), avg %u ms radio on, %u ms saved",
+		(unsigned int)stats.scans, (unsigned int)stats.allHeard, (unsigned int)stats.quiet, (unsigned int)stats.full,
+		(unsigned int)stats.lastRadioOnMs, (unsigned int)stats.lastExpected,
+		(unsigned int)(stats.radioOnUs / stats.scans / 1000), (unsigned int)(stats.savedUs / 1000));
+}
+
+/**
+ * @brief Hands changed runtime parameters to whatever uses them. Cycle and receive
+ * times are read every cycle so need nothing here.
+ * 
+ * @param changed PARAM_BIT() mask
+ */
+static void applyParams(uint32_t changed)
+{
+	esp_err_t ret;
+
+	if (changed & (PARAM_BIT(PARAM_SCAN_INTERVAL) | PARAM_BIT(PARAM_SCAN_WINDOW))){
+		ble_scan_params.scan_interval = params_get(PARAM_SCAN_INTERVAL);
+		ble_scan_params.scan_window = params_get(PARAM_SCAN_WINDOW);
+		ret = esp_ble_gap_set_scan_params(&ble_scan_params);
+		if (ret){
+			ESP_LOGE(TAG, "%s Failed to configure scan params, error: %s", __func__, esp_err_to_name(ret));
+		}
+		checkQuietPeriod();
+	}
+
+	if (changed & PARAM_BIT(PARAM_QUEUE_LEN)){
+		beaconHandoffSetLength(params_get(PARAM_QUEUE_LEN));
+	}
+
+	if (changed & PARAM_BIT(PARAM_DEVICE_ID)){
+		s_deviceID = params_get(PARAM_DEVICE_ID);
+	}
+}
+
+/**
+ * @brief Warns when the quiet period is shorter than the time it takes to hear the
+ * slowest beacon at the current scan duty cycle, early stops would cut those off
+ * 
+ */
+static void checkQuietPeriod(void)
+{
+#if defined(CONFIG_SCAN_EARLY_STOP)
+	uint32_t hearMs = CONFIG_SCAN_ADV_INTERVAL_MS * ble_scan_params.scan_interval / ble_scan_params.scan_window;
 
-  return 0;
-}
\ No newline at end of file
+	if (CONFIG_SCAN_QUIET_MS <= hearMs){
+		ESP_LOGW(TAG, "Quiet period of %u ms is too short, a beacon advertising every %u ms takes about %u ms to hear at this scan window",
+			(unsigned int)CONFIG_SCAN_QUIET_MS, (unsigned int)CONFIG_SCAN_ADV_INTERVAL_MS, (unsigned int)hearMs);
+	}
+#endif
+}
@@ -21,69 +21,6 @@
 
 static const char TAG[] = "beacon BLE";
 
-bool ble_is_beacon(uint8_t *buf)
-{
-	bool isBeacon = false;
-	uint8_t *value;
-	uint8_t len;
-	uint8_t MSD[] = ADV_DATA_MAN_DATA;
-
-	// Check manufacturer specific data
-	value = esp_ble_resolve_adv_data(buf, 0xFF, &len);
-	if (0 == memcmp(value, MSD, len) && len == 4)
-	{
-		isBeacon = true;
-	}
-
-	return isBeacon;
-}
-
-esp_err_t ble_beacon_decode(uint8_t *buf, ble_beacon_recived_t* received_data)
-{
-	esp_err_t ret = ESP_OK;
-	uint8_t *value;
-	uint8_t len;
-	
-	// Get MSD
-	value = esp_ble_resolve_adv_data(buf, 0xFF, &len);
-	if(len == ADV_DATA_MAN_LEN)
-	{
-		memcpy(received_data->msd, value, len);
-	}
-	else
-	{
-		ESP_LOGE(TAG, "%s BLE recived decode of MSD failed\n", __func__);
-		return ESP_FAIL;
-	}
-
-	// Get 32b UUID
-	value = esp_ble_resolve_adv_data(buf, 0x16, &len);
-	if(len == ADV_DATA_SERVICE_LEN)
-	{
-		memcpy(received_data->uuid_32b, value, len);
-	}
-	else
-	{
-		ESP_LOGE(TAG, "%s BLE recived decode of UUID32b failed\n", __func__);
-		return ESP_FAIL;
-	}
-
-	// Get Tx power
-	value = esp_ble_resolve_adv_data(buf, 0x0A, &len);
-	if(len == 1)
-	{
-		//memcpy(received_data->TxPower, value, len);
-		received_data->TxPower = *value;
-	}
-	else
-	{
-		ESP_LOGE(TAG, "%s BLE recived decode of TxPower failed\n", __func__);
-		return ESP_FAIL;
-	}
-
-	return ret;
-}
-
 esp_err_t ble_beacon_appRegister(esp_gap_ble_cb_t callback)
 {
 	esp_err_t ret;
@@ -47,10 +47,80 @@ typedef struct{
 	int8_t rssi;
 	int packetGroup;							// Needs to be removed for non testing as this can only recive so many packets (This value will itterate once per scan cycle)
 	int8_t deviceID;
+	uint8_t format;								// ble_beacon_format_t
+	uint8_t event;								// ble_beacon_event_t
 }ble_beacon_recived_t;
 
+// What a reading reports. Scans produce sightings, presence.c turns them into events
+typedef enum {
+	BLE_BEACON_EVENT_SIGHTING = 0,
+	BLE_BEACON_EVENT_ENTER,
+	BLE_BEACON_EVENT_EXIT,
+	BLE_BEACON_EVENT_HEARTBEAT
+} ble_beacon_event_t;
+
+// Beacon formats understood by ble_beacon_classify(), one table entry each in beaconDecode.c
+typedef enum {
+	BLE_BEACON_FORMAT_NONE = 0,
+	BLE_BEACON_FORMAT_FH,						// Our own tags (ADV_DATA_MAN_DATA + 32b service data)
+	BLE_BEACON_FORMAT_IBEACON,
+	BLE_BEACON_FORMAT_EDDYSTONE_UID,
+	BLE_BEACON_FORMAT_ALTBEACON,
+	BLE_BEACON_FORMAT_COUNT
+} ble_beacon_format_t;
+
+#define BLE_BEACON_ID_MAX_LEN 20
+
+// Reading normalised from any supported format. base.uuid_32b holds the beacon key the
+// rest of the pipeline keys on: the ID itself for our own tags, an FNV-1a hash of the
+// whole ID for the longer foreign ones
+typedef struct {
+	ble_beacon_recived_t base;
+	uint8_t id[BLE_BEACON_ID_MAX_LEN];			// iBeacon UUID+major+minor, Eddystone namespace+instance, AltBeacon ID, FH uuid_32b
+	uint8_t idLen;
+} ble_beacon_reading_t;
+
+/**
+ * @brief Key used to tell beacons apart (uuid_32b as a big endian integer, see
+ * ble_beacon_reading_t)
+ * 
+ * @param rd 
+ * @return uint32_t 
+ */
+static inline uint32_t ble_beacon_key(const ble_beacon_recived_t *rd)
+{
+	return ((uint32_t)rd->uuid_32b[0] << 24) | ((uint32_t)rd->uuid_32b[1] << 16) | ((uint32_t)rd->uuid_32b[2] << 8) | rd->uuid_32b[3];
+}
+
+/**
+ * @brief Identifies the beacon format in a single pass over the advertisement and
+ * normalises it into reading. rssi, packetGroup and deviceID are left for the caller.
+ * 
+ * @param buf (scan_rst.ble_adv)
+ * @param len (scan_rst.adv_data_len + scan_rst.scan_rsp_len)
+ * @param reading filled out when a format matches, may be NULL to only classify
+ * @return ble_beacon_format_t BLE_BEACON_FORMAT_NONE if nothing matched
+ */
+ble_beacon_format_t ble_beacon_classify(const uint8_t *buf, uint8_t len, ble_beacon_reading_t *reading);
+
+/**
+ * @brief Matches per format since boot
+ * 
+ * @param counts BLE_BEACON_FORMAT_COUNT entries, indexed by ble_beacon_format_t
+ */
+void ble_beacon_get_format_counts(uint32_t counts[BLE_BEACON_FORMAT_COUNT]);
+
+/**
+ * @brief Name of a format for logging
+ * 
+ * @param format 
+ * @return const char* 
+ */
+const char *ble_beacon_format_name(ble_beacon_format_t format);
+
 /**
- * @brief Checks if the recived data is a beacon. This is determined through msd = ADV_DATA_MAN_DATA
+ * @brief Checks if the recived data is one of our own beacons. This is determined through msd = ADV_DATA_MAN_DATA
+ * (ble_beacon_classify() covers every format)
  * 
  * @param buf 
  * @return true 
@@ -0,0 +1,294 @@
+/**
+ * @file beaconDecode.c
+ * @author Flynn Harrison
+ * @brief Advertisement classification and decode, kept apart from the controller
+ * setup in beaconBLE.c so it also builds for the host benchmarks
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "beaconBLE.h"
+
+#include <esp_log.h>
+
+#include <string.h>
+
+static const char TAG[] = "beacon decode";
+
+bool ble_is_beacon(uint8_t *buf)
+{
+	bool isBeacon = false;
+	uint8_t *value;
+	uint8_t len;
+	uint8_t MSD[] = ADV_DATA_MAN_DATA;
+
+	// Check manufacturer specific data
+	value = esp_ble_resolve_adv_data(buf, 0xFF, &len);
+	if (len == ADV_DATA_MAN_LEN && 0 == memcmp(value, MSD, len))
+	{
+		isBeacon = true;
+	}
+
+	return isBeacon;
+}
+
+esp_err_t ble_beacon_decode(uint8_t *buf, ble_beacon_recived_t* received_data)
+{
+	esp_err_t ret = ESP_OK;
+	uint8_t *value;
+	uint8_t len;
+	
+	// Get MSD
+	value = esp_ble_resolve_adv_data(buf, 0xFF, &len);
+	if(len == ADV_DATA_MAN_LEN)
+	{
+		memcpy(received_data->msd, value, len);
+	}
+	else
+	{
+		ESP_LOGE(TAG, "%s BLE recived decode of MSD failed\n", __func__);
+		return ESP_FAIL;
+	}
+
+	// Get 32b UUID
+	value = esp_ble_resolve_adv_data(buf, 0x16, &len);
+	if(len == ADV_DATA_SERVICE_LEN)
+	{
+		memcpy(received_data->uuid_32b, value, len);
+	}
+	else
+	{
+		ESP_LOGE(TAG, "%s BLE recived decode of UUID32b failed\n", __func__);
+		return ESP_FAIL;
+	}
+
+	// Get Tx power
+	value = esp_ble_resolve_adv_data(buf, 0x0A, &len);
+	if(len == 1)
+	{
+		//memcpy(received_data->TxPower, value, len);
+		received_data->TxPower = *value;
+	}
+	else
+	{
+		ESP_LOGE(TAG, "%s BLE recived decode of TxPower failed\n", __func__);
+		return ESP_FAIL;
+	}
+
+	received_data->format = BLE_BEACON_FORMAT_FH;
+	received_data->event = BLE_BEACON_EVENT_SIGHTING;
+
+	return ret;
+}
+
+// ---- Table driven classifier ----
+
+#define AD_TYPE_TX_POWER		0x0A
+#define AD_TYPE_SERVICE_DATA	0x16
+#define AD_TYPE_MANUFACTURER	0xFF
+
+#define TX_FROM_AD -1		// TxPower comes from the AD_TYPE_TX_POWER structure
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME        16777619u
+
+typedef struct {
+	ble_beacon_format_t format;
+	const char *name;
+	uint8_t sigType;		// AD structure holding the signature
+	uint8_t sigOffset;		// Where the signature starts in its payload
+	uint8_t sig[4];
+	uint8_t sigLen;
+	uint8_t minLen;			// Minimum payload length of the signature structure
+	bool exactLen;			// Payload must be exactly minLen
+	uint8_t idType;			// AD structure holding the ID, may differ from sigType
+	uint8_t idOffset;
+	uint8_t idLen;
+	int8_t txOffset;		// TxPower in the signature payload or TX_FROM_AD
+} ble_format_entry_t;
+
+// Checked in order, the first match wins. Adding a format means adding an entry here
+static const ble_format_entry_t s_formats[] = {
+	{ BLE_BEACON_FORMAT_FH,            "FH",            AD_TYPE_MANUFACTURER, 0, ADV_DATA_MAN_DATA,          4, ADV_DATA_MAN_LEN, true,  AD_TYPE_SERVICE_DATA, 0, ADV_DATA_SERVICE_LEN, TX_FROM_AD },
+	{ BLE_BEACON_FORMAT_IBEACON,       "iBeacon",       AD_TYPE_MANUFACTURER, 0, { 0x4C, 0x00, 0x02, 0x15 }, 4, 25,               false, AD_TYPE_MANUFACTURER, 4, 20,                   24 },
+	{ BLE_BEACON_FORMAT_EDDYSTONE_UID, "Eddystone-UID", AD_TYPE_SERVICE_DATA, 0, { 0xAA, 0xFE, 0x00 },       3, 18,               false, AD_TYPE_SERVICE_DATA, 4, 16,                   3 },
+	{ BLE_BEACON_FORMAT_ALTBEACON,     "AltBeacon",     AD_TYPE_MANUFACTURER, 2, { 0xBE, 0xAC },             2, 26,               false, AD_TYPE_MANUFACTURER, 4, 20,                   24 },
+};
+#define FORMAT_TABLE_LEN (sizeof(s_formats) / sizeof(s_formats[0]))
+
+static uint32_t s_formatCounts[BLE_BEACON_FORMAT_COUNT];
+
+/**
+ * @brief Beacon key for IDs longer than uuid_32b, so beacons that only differ early
+ * in the ID (iBeacon UUID) still get their own key. FNV-1a over the ID's little endian
+ * words rather than bytes (IDs are whole words) to stay cheap in the GAP callback,
+ * with the murmur3 finaliser so every ID bit reaches every key bit.
+ * 
+ * @param id 
+ * @param len multiple of 4
+ * @return uint32_t 
+ */
+static uint32_t ble_id_hash(const uint8_t *id, uint8_t len)
+{
+	uint32_t hash = FNV_OFFSET_BASIS;
+
+	for (uint8_t i = 0; i + 4 <= len; i += 4)
+	{
+		hash = (hash ^ (id[i] | (uint32_t)id[i + 1] << 8 | (uint32_t)id[i + 2] << 16 | (uint32_t)id[i + 3] << 24)) * FNV_PRIME;
+	}
+
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35u;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+static bool ble_format_match(const ble_format_entry_t *entry, uint8_t type, const uint8_t *data, uint8_t dataLen)
+{
+	return type == entry->sigType
+		&& dataLen >= entry->minLen
+		&& (!entry->exactLen || dataLen == entry->minLen)
+		&& dataLen >= entry->sigOffset + entry->sigLen
+		&& memcmp(&data[entry->sigOffset], entry->sig, entry->sigLen) == 0;
+}
+
+ble_beacon_format_t ble_beacon_classify(const uint8_t *buf, uint8_t len, ble_beacon_reading_t *reading)
+{
+	const ble_format_entry_t *match = NULL;
+	const uint8_t *sigData = NULL;
+	uint8_t sigDataLen = 0;
+	const uint8_t *idData = NULL;
+	uint8_t idDataLen = 0;
+	const uint8_t *txPower = NULL;
+	const uint8_t *serviceData = NULL;
+	uint8_t serviceDataLen = 0;
+	const uint8_t *manufacturer = NULL;
+	uint8_t manufacturerLen = 0;
+	const uint8_t *data;
+	uint8_t adLen, type, dataLen;
+	uint32_t hash;
+	size_t i = 0;
+
+	// Single pass over the AD structures, remembering the ones an ID or TxPower may live in
+	while (i + 1 < len)
+	{
+		adLen = buf[i];
+		if (adLen == 0 || i + 1 + adLen > len)
+		{
+			break;
+		}
+		type = buf[i + 1];
+		data = &buf[i + 2];
+		dataLen = adLen - 1;
+
+		if (type == AD_TYPE_TX_POWER && dataLen == 1)
+		{
+			txPower = data;
+		}
+		else if (type == AD_TYPE_SERVICE_DATA && serviceData == NULL)
+		{
+			serviceData = data;
+			serviceDataLen = dataLen;
+		}
+		else if (type == AD_TYPE_MANUFACTURER && manufacturer == NULL)
+		{
+			manufacturer = data;
+			manufacturerLen = dataLen;
+		}
+
+		for (int f = 0; match == NULL && f < FORMAT_TABLE_LEN; f++)
+		{
+			if (ble_format_match(&s_formats[f], type, data, dataLen))
+			{
+				match = &s_formats[f];
+				sigData = data;
+				sigDataLen = dataLen;
+			}
+		}
+
+		i += adLen + 1;
+	}
+
+	if (match == NULL)
+	{
+		return BLE_BEACON_FORMAT_NONE;
+	}
+
+	// ID is either in the signature structure or the first structure of idType
+	if (match->idType == match->sigType)
+	{
+		idData = sigData;
+		idDataLen = sigDataLen;
+	}
+	else if (match->idType == AD_TYPE_SERVICE_DATA)
+	{
+		idData = serviceData;
+		idDataLen = serviceDataLen;
+	}
+	else if (match->idType == AD_TYPE_MANUFACTURER)
+	{
+		idData = manufacturer;
+		idDataLen = manufacturerLen;
+	}
+	if (idData == NULL || idDataLen < match->idOffset + match->idLen)
+	{
+		return BLE_BEACON_FORMAT_NONE;
+	}
+
+	s_formatCounts[match->format]++;
+	if (reading == NULL)
+	{
+		return match->format;
+	}
+
+	memcpy(reading->id, &idData[match->idOffset], match->idLen);
+	reading->idLen = match->idLen;
+	memcpy(reading->base.msd, sigData, ADV_DATA_MAN_LEN < sigDataLen ? ADV_DATA_MAN_LEN : sigDataLen);
+	if (reading->idLen == ADV_DATA_SERVICE_LEN)
+	{
+		memcpy(reading->base.uuid_32b, reading->id, ADV_DATA_SERVICE_LEN);
+	}
+	else
+	{
+		// Big endian like our own tags' uuid_32b, so ble_beacon_key() returns the hash
+		hash = ble_id_hash(reading->id, reading->idLen);
+		reading->base.uuid_32b[0] = hash >> 24;
+		reading->base.uuid_32b[1] = hash >> 16;
+		reading->base.uuid_32b[2] = hash >> 8;
+		reading->base.uuid_32b[3] = hash;
+	}
+	if (match->txOffset == TX_FROM_AD)
+	{
+		reading->base.TxPower = txPower != NULL ? *txPower : 0;
+	}
+	else
+	{
+		reading->base.TxPower = sigData[match->txOffset];
+	}
+	reading->base.format = match->format;
+
+	return match->format;
+}
+
+void ble_beacon_get_format_counts(uint32_t counts[BLE_BEACON_FORMAT_COUNT])
+{
+	memcpy(counts, s_formatCounts, sizeof(s_formatCounts));
+}
+
+const char *ble_beacon_format_name(ble_beacon_format_t format)
+{
+	for (int f = 0; f < FORMAT_TABLE_LEN; f++)
+	{
+		if (s_formats[f].format == format)
+		{
+			return s_formats[f].name;
+		}
+	}
+
+	return "none";
+}
@@ -0,0 +1,33 @@
+/**
+ * @file beaconList.c
+ * @author Flynn Harrison
+ * @brief List of beacons already heard in the current scan
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "beaconList.h"
+
+uint8_t isInList(struct list_s * beaconList, uint32_t id)
+{
+  for (int i = 0; i < beaconList->size; i++)
+  {
+    if (id == beaconList->list[i])
+    {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+void addToList(struct list_s * beaconList, uint32_t id)
+{
+  if (beaconList->size < BEACON_LIST_SIZE)
+  {
+    beaconList->list[beaconList->size++] = id;
+  }
+}
@@ -0,0 +1,42 @@
+/**
+ * @file beaconList.h
+ * @author Flynn Harrison
+ * @brief List of beacons already heard in the current scan
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef BEACONLIST_H
+#define BEACONLIST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BEACON_LIST_SIZE 20
+
+struct list_s {
+  uint32_t list[BEACON_LIST_SIZE];
+  size_t  size;
+};
+
+/**
+ * @brief Checks if id has been added to the list
+ * 
+ * @param beaconList 
+ * @param id 
+ * @return uint8_t 1 if found
+ */
+uint8_t isInList(struct list_s * beaconList, uint32_t id);
+
+/**
+ * @brief Adds id to the list, ignored once the list is full
+ * 
+ * @param beaconList 
+ * @param id 
+ */
+void addToList(struct list_s * beaconList, uint32_t id);
+
+#endif
@@ -0,0 +1,142 @@
+/**
+ * @file compress.c
+ * @author Flynn Harrison
+ * @brief Small LZ77 style compressor for upload batches
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "compress.h"
+
+static compress_stats_t s_stats;
+
+int compress_lz(const uint8_t *in, size_t inLen, uint8_t *out, size_t outCap)
+{
+	size_t i = 0;
+	size_t o = 0;
+	size_t flagPos = 0;
+	size_t start, bestLen, bestOff, l;
+	uint8_t bit = 8;
+
+	while (i < inLen)
+	{
+		// New flag byte every 8 tokens
+		if (bit == 8)
+		{
+			if (o >= outCap)
+			{
+				return COMPRESS_ERROR;
+			}
+			flagPos = o++;
+			out[flagPos] = 0;
+			bit = 0;
+		}
+
+		// Longest match in the window, matches may run into the bytes being encoded
+		bestLen = 0;
+		bestOff = 0;
+		start = i > COMPRESS_WINDOW ? i - COMPRESS_WINDOW : 0;
+		for (size_t j = start; j < i; j++)
+		{
+			l = 0;
+			while (i + l < inLen && l < COMPRESS_MAX_MATCH && in[j + l] == in[i + l])
+			{
+				l++;
+			}
+			if (l > bestLen)
+			{
+				bestLen = l;
+				bestOff = i - j;
+			}
+		}
+
+		if (bestLen >= COMPRESS_MIN_MATCH)
+		{
+			if (o + 2 > outCap)
+			{
+				return COMPRESS_ERROR;
+			}
+			out[o++] = (uint8_t)(bestOff - 1);
+			out[o++] = (uint8_t)(bestLen - COMPRESS_MIN_MATCH);
+			i += bestLen;
+		}
+		else
+		{
+			if (o >= outCap)
+			{
+				return COMPRESS_ERROR;
+			}
+			out[flagPos] |= 1 << bit;
+			out[o++] = in[i++];
+		}
+		bit++;
+	}
+
+	return o;
+}
+
+int decompress_lz(const uint8_t *in, size_t inLen, uint8_t *out, size_t outCap)
+{
+	size_t i = 0;
+	size_t o = 0;
+	size_t off, len;
+	uint8_t flags = 0;
+	uint8_t bit = 8;
+
+	while (i < inLen)
+	{
+		if (bit == 8)
+		{
+			flags = in[i++];
+			bit = 0;
+			continue;
+		}
+
+		if (flags & (1 << bit))
+		{
+			if (o >= outCap)
+			{
+				return COMPRESS_ERROR;
+			}
+			out[o++] = in[i++];
+		}
+		else
+		{
+			if (i + 2 > inLen)
+			{
+				return COMPRESS_ERROR;
+			}
+			off = in[i] + 1;
+			len = in[i + 1] + COMPRESS_MIN_MATCH;
+			i += 2;
+			if (off > o || o + len > outCap)
+			{
+				return COMPRESS_ERROR;
+			}
+			for (size_t k = 0; k < len; k++, o++)
+			{
+				out[o] = out[o - off];
+			}
+		}
+		bit++;
+	}
+
+	return o;
+}
+
+void compress_record_batch(size_t rawLen, size_t compressedLen, uint32_t cpuUs)
+{
+	s_stats.batches++;
+	s_stats.rawBytes += rawLen;
+	s_stats.compressedBytes += compressedLen;
+	s_stats.cpuUs += cpuUs;
+	s_stats.lastCpuUs = cpuUs;
+}
+
+void compress_get_stats(compress_stats_t *stats)
+{
+	*stats = s_stats;
+}
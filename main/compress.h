@@ -0,0 +1,73 @@
+/**
+ * @file compress.h
+ * @author Flynn Harrison
+ * @brief Small LZ77 style compressor for upload batches. Works on one batch at a
+ * time with no heap and no match tables, the window is the batch itself.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Stream format: a flag byte followed by up to 8 tokens, flag bit n (LSB first) set
+// means token n is a literal byte, clear means a 2 byte match [offset - 1, length - 3]
+#define COMPRESS_WINDOW     256
+#define COMPRESS_MIN_MATCH  3
+#define COMPRESS_MAX_MATCH  (255 + COMPRESS_MIN_MATCH)
+
+#define COMPRESS_ERROR -1
+
+typedef struct {
+	uint32_t batches;
+	uint32_t rawBytes;
+	uint32_t compressedBytes;
+	uint32_t cpuUs;				// Total time spent compressing
+	uint32_t lastCpuUs;
+} compress_stats_t;
+
+/**
+ * @brief Compresses in into out
+ * 
+ * @param in 
+ * @param inLen 
+ * @param out 
+ * @param outCap size of out
+ * @return int compressed length or COMPRESS_ERROR if it did not fit in out
+ */
+int compress_lz(const uint8_t *in, size_t inLen, uint8_t *out, size_t outCap);
+
+/**
+ * @brief Reverses compress_lz
+ * 
+ * @param in 
+ * @param inLen 
+ * @param out 
+ * @param outCap size of out
+ * @return int decompressed length or COMPRESS_ERROR on malformed input or overflow
+ */
+int decompress_lz(const uint8_t *in, size_t inLen, uint8_t *out, size_t outCap);
+
+/**
+ * @brief Adds a batch to the running totals
+ * 
+ * @param rawLen 
+ * @param compressedLen 
+ * @param cpuUs 
+ */
+void compress_record_batch(size_t rawLen, size_t compressedLen, uint32_t cpuUs);
+
+/**
+ * @brief Copy of the running totals
+ * 
+ * @param stats 
+ */
+void compress_get_stats(compress_stats_t *stats);
+
+#endif
@@ -11,80 +11,86 @@
 
 #include "databaseApp.h"
 
+#include <string.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
 
 #include "beaconBLE.h"
+#include "record.h"
 #include "http.h"
+#include "https.h"
+#include "udp.h"
+#include "compress.h"
+#include "uartSink.h"
+#include "presence.h"
+#include "profile.h"
+#include "pacer.h"
+#include "params.h"
 #include "globalQueues.h"
+#include "WiFi.h"
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+#include "rssiHist.h"
+#endif
+#if defined(CONFIG_SCAN_SLOTTED)
+#include "timeSlot.h"
+#endif
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+#include "fingerprint.h"
+#endif
 
 #define CYCLE_RATE_MS 1000*10
 
-#define HTTP_SERVER				"159.196.72.33"
 #define HTTP_PORT         "5000"
-#define HTTP_DATABASE			"rssi_submit"
-#define HTTP_VAR_PACKET_GROUP   "pkGroup"
-#define HTTP_VAR_UUID           "uuid"
-#define HTTP_VAR_RSSI           "rssi"
-#define HTTP_VAR_TX_POWER       "txPower"
-#define HTTP_VAR_DEVICEID		"deviceID"
-#define HTTP_VAR_BUFF_SIZE		80
+#define HTTPS_PORT        CONFIG_UPLOAD_HTTPS_PORT
+#define UDP_PORT          CONFIG_UPLOAD_UDP_PORT
+#define HTTP_VAR_BUFF_SIZE		(RECORD_QUERY_SIGHTING_MAX + 1)
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+#define HTTP_HIST_BUFF_SIZE		(RECORD_QUERY_HISTOGRAM_MAX(RSSI_HIST_BINS) + 1)
+#endif
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+#define HTTP_FP_BUFF_SIZE		(RECORD_QUERY_FINGERPRINT_MAX(FINGERPRINT_BEACONS) + 1)
+#endif
 
 static const char TAG[] = "Database app";
 
+static TaskHandle_t s_uploadTask = NULL;
+static char s_server[PARAM_STR_MAX + 1];		// Collector address, the server parameter
+
+static bool uploadReading(const ble_beacon_recived_t *rd);
+static void uploadFlush(void);
+static void uploadDisconnect(void);
+static void refreshServer(void);
+static bool uploadOpen(void);
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+static bool uploadHistogram(const rssiHist_t *hist);
+static unsigned int uploadHistograms(int64_t now);
+#endif
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+static void uploadFingerprint(const fingerprint_t *fp);
+#endif
+#if defined(CONFIG_PRESENCE_EVENTS)
+static unsigned int presenceObserve(bool *deliver, unsigned int *count);
+#endif
+
 void vDatabaseContact(void *pvParameters)
 {
-	char paramBuff[HTTP_VAR_BUFF_SIZE];
-	int n;
-	ble_beacon_recived_t *rd;
-	TickType_t xLastWakeTick;
-
 	ESP_LOGI(TAG, "vDatabaseContact app started");
-	xLastWakeTick = xTaskGetTickCount();
+	s_uploadTask = xTaskGetCurrentTaskHandle();
 
 	for(;;){
-		vTaskDelayUntil(&xLastWakeTick, pdMS_TO_TICKS(CYCLE_RATE_MS));
-		ESP_LOGI(TAG, "starting for next loop");
-		
-
-		// Check if queue exits yet
-		if (beaconQueueHandle == NULL){
-			ESP_LOGI(TAG, "Queue empty -> skipping");
-			//continue;
-		}
+		// Woken by databaseNotify() at the end of a scan, or every CYCLE_RATE_MS regardless
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CYCLE_RATE_MS));
+		ESP_LOGD(TAG, "starting for next loop");
 
-		// Loop que data
-		while (uxQueueMessagesWaiting(beaconQueueHandle) > 0){
-
-			// Get data off queue
-			if (xQueueReceive(beaconQueueHandle, &rd, 0) != pdPASS){
-				ESP_LOGE(TAG, "Failed to pull data from queue");
-				vPortFree(rd);
-				//continue;
-			}
-
-			// Construct http request
-			// Non ideal code																																\|/ for testing we only care about the last number
-			n = snprintf(paramBuff, HTTP_VAR_BUFF_SIZE, "%s?%s=%d&%s=%d&%s=%d", HTTP_DATABASE, HTTP_VAR_PACKET_GROUP,rd->packetGroup, HTTP_VAR_UUID, rd->uuid_32b[3], HTTP_VAR_RSSI, rd->rssi);
-			if (n < 0 || n > HTTP_VAR_BUFF_SIZE){
-				ESP_LOGE(TAG, "Unable to construct HTTP request paramters. Too long?");
-				vPortFree(rd);
-				//continue;
-			}
-
-			// Freeing data from queue, look at BLE GAP callback for malloc
-			vPortFree(rd);
-
-			// Send over HTTP
-			if (http_send_request(HTTP_SERVER, HTTP_PORT, paramBuff) != HTTP_ERROR){
-				ESP_LOGI(TAG, "Added entery to database");
-			} else {
-				ESP_LOGE(TAG, "Failed to add entery to database");
-			}
-			vTaskDelay(100/portTICK_PERIOD_MS);
-		}
+#if !defined(CONFIG_UPLOAD_TRANSPORT_UART)
+		WiFiWaitUntillConnected();
+#endif
+		databaseContact();
 
 		//ESP_LOGI(TAG, "%s Stack high water mark: %u", __func__, uxTaskGetStackHighWaterMark(NULL));
 	}
@@ -92,47 +98,523 @@ void vDatabaseContact(void *pvParameters)
 	vTaskDelete(NULL);
 }
 
+void databaseNotify()
+{
+	if (s_uploadTask != NULL){
+		xTaskNotifyGive(s_uploadTask);
+	}
+}
+
 void databaseContact()
 {
-	char paramBuff[HTTP_VAR_BUFF_SIZE];
+#if defined(CONFIG_PRESENCE_EVENTS)
+	bool deliver = false;
 	int n;
-	ble_beacon_recived_t *rd;
+#else
+	ble_beacon_recived_t rd;
+#endif
+	unsigned int count = 0;
+	unsigned int sent = 0;
+	int64_t start;
+	int64_t elapsed;
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+	fingerprint_t fp;
+#endif
+
+	refreshServer();
+
+#if defined(CONFIG_PRESENCE_EVENTS)
+	// Scans keep moving presence state while held off, the events wait for a later cycle
+	if (pacer_holding()){
+		presenceObserve(&deliver, &count);
+	}
+#else
+	// Readings stay in the backlog (coalesced per beacon) until the server lets us back
+	beaconHandoffCollect();
+#endif
+	if (pacer_holding()){
+		ESP_LOGI(TAG, "Holding off uploads for another %u ms", (unsigned int)pacer_hold_remaining_ms());
+		return;
+	}
 
-	// Check if queue exits yet
-	if (beaconQueueHandle == NULL){
-		ESP_LOGI(TAG, "Queue empty -> skipping");
-		//continue;
+#if defined(CONFIG_SCAN_SLOTTED)
+	// Neighbours finished the same scan, each waits for its own slot (jitter until the clock is set)
+	if (!time_slot_wait_upload(params_get(PARAM_DEVICE_ID), params_get(PARAM_CYCLE_MS), params_get(PARAM_RX_MS))){
+		pacer_jitter();
 	}
+#elif !defined(CONFIG_UPLOAD_TRANSPORT_UART)
+	// Spread receivers that finished scanning at the same time
+	pacer_jitter();
+#endif
 
-	// Loop que data
-	while (uxQueueMessagesWaiting(beaconQueueHandle) > 0){
+	start = esp_timer_get_time();
+	PROFILE_BEGIN(PROFILE_UPLOAD);
 
-		// Get data off queue
-		if (xQueueReceive(beaconQueueHandle, &rd, 0) != pdPASS){
-			ESP_LOGE(TAG, "Failed to pull data from queue");
-			vPortFree(rd);
-			//continue;
-		}
+#if defined(CONFIG_PRESENCE_EVENTS)
+	// Only zone changes and heartbeats are uploaded, an event not delivered comes up again
+	deliver = true;
+	sent += presenceObserve(&deliver, &count);
 
-		// Construct http request
-		// Non ideal code																																\|/ for testing we only care about the last number
-		n = snprintf(paramBuff, HTTP_VAR_BUFF_SIZE, "%s?%s=%d&%s=%d&%s=%d&%s=%d", HTTP_DATABASE, HTTP_VAR_PACKET_GROUP,rd->packetGroup, HTTP_VAR_UUID, rd->uuid_32b[3], HTTP_VAR_RSSI, rd->rssi, HTTP_VAR_DEVICEID, rd->deviceID);
-		if (n < 0 || n > HTTP_VAR_BUFF_SIZE){
-			ESP_LOGE(TAG, "Unable to construct HTTP request paramters. Too long?");
-			vPortFree(rd);
-			//continue;
+	// Beacons not heard for a while leave even when nothing was received this cycle
+	if (deliver && uploadOpen() && (n = presence_sweep(esp_timer_get_time(), uploadReading)) != PRESENCE_ERROR){
+		sent += n;
+	}
+#else
+	// Loop que data, stopping early if the server asks us to back off, the upload slot
+	// closes or an upload fails
+	while (uploadOpen() && beaconHandoffReceive(&rd)){
+		count++;
+		if (!uploadReading(&rd)){
+			// Back in the backlog for the next cycle
+			beaconHandoffRequeue(&rd);
+			break;
 		}
+		sent++;
+	}
+#endif
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+	if (uploadOpen()){
+		sent += uploadHistograms(start);
+	}
+#endif
+
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+	// Only the last scan's, an older one not uploaded in time has been replaced
+	if (uploadOpen() && fingerprint_take(&fp)){
+		uploadFingerprint(&fp);
+		sent++;
+	}
+#endif
 
-		// Freeing data from queue, look at BLE GAP callback for malloc
-		vPortFree(rd);
+	uploadFlush();
+	PROFILE_END(PROFILE_UPLOAD);
+	PROFILE_UPLOAD_END();
 
-		// Send over HTTP
-		if (http_send_request(HTTP_SERVER, HTTP_PORT, paramBuff) != HTTP_ERROR){
-			ESP_LOGD(TAG, "Added entery to database");
+	// Upload throughput, compare across targets
+	if (sent > 0){
+		elapsed = esp_timer_get_time() - start;
+		ESP_LOGI(TAG, "Uploaded %u records for %u readings in %u ms (%u records/s)", sent, count, (unsigned int)(elapsed / 1000),
+			(unsigned int)(elapsed > 0 ? sent * 1000000LL / elapsed : 0));
+	}
+}
+
+/**
+ * @brief Whether another upload request can start, not while the server has asked
+ * us to back off or once this receiver's upload slot has closed
+ * 
+ * @return true
+ * @return false
+ */
+static bool uploadOpen(void)
+{
+#if defined(CONFIG_SCAN_SLOTTED)
+	return !pacer_holding() && time_slot_upload_open();
+#else
+	return !pacer_holding();
+#endif
+}
+
+#if defined(CONFIG_PRESENCE_EVENTS)
+/**
+ * @brief Stands in for uploadReading once events can not go out, the state machine
+ * keeps them for a later sighting or sweep
+ * 
+ * @param rd 
+ * @return false
+ */
+static bool presenceDefer(const ble_beacon_recived_t *rd)
+{
+	return false;
+}
+
+/**
+ * @brief Feeds every reading sent since the last call into presence at the time it
+ * was heard, one per beacon per scan, so a late upload neither merges scans nor ages
+ * the beacon. Events are uploaded while deliver holds, it is cleared once one fails
+ * or the upload slot closes.
+ * 
+ * @param deliver 
+ * @param count incremented per reading
+ * @return unsigned int events uploaded
+ */
+static unsigned int presenceObserve(bool *deliver, unsigned int *count)
+{
+	ble_beacon_recived_t rd;
+	int64_t seenUs;
+	unsigned int sent = 0;
+	int n;
+
+	while (beaconHandoffTake(&rd, &seenUs)){
+		(*count)++;
+		*deliver = *deliver && uploadOpen();
+		n = presence_observe(&rd, seenUs, *deliver ? uploadReading : presenceDefer);
+		if (n == PRESENCE_ERROR){
+			*deliver = false;
 		} else {
-			ESP_LOGE(TAG, "Failed to add entery to database");
+			sent += n;
+		}
+	}
+
+	return sent;
+}
+#endif
+
+/**
+ * @brief Picks up a collector address pushed since the last upload, dropping any
+ * connection to the old one
+ * 
+ */
+static void refreshServer(void)
+{
+	char server[PARAM_STR_MAX + 1];
+
+	params_get_str(PARAM_SERVER, server, sizeof(server));
+	if (strcmp(server, s_server) != 0){
+		if (s_server[0] != '\0'){
+			ESP_LOGI(TAG, "Collector changed from %s to %s", s_server, server);
+			uploadDisconnect();
 		}
-		vTaskDelay(100/portTICK_PERIOD_MS);
+		strcpy(s_server, server);
+	}
+}
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+/**
+ * @brief Uploads and resets every beacon's RSSI histogram once the interval is up
+ * 
+ * @param now 
+ * @return unsigned int histograms uploaded
+ */
+static unsigned int uploadHistograms(int64_t now)
+{
+	rssiHist_t hist;
+	unsigned int count = 0;
+	int index = 0;
+
+	if (!rssi_hist_due(now)){
+		return 0;
+	}
+
+	// Stops when the server asks us to back off or the slot closes, the rest stay for
+	// the next round and the interval only restarts once every histogram is taken
+	while (uploadOpen() && rssi_hist_take(&index, &hist)){
+		if (!uploadHistogram(&hist)){
+			rssi_hist_return(&hist);
+			break;
+		}
+		count++;
+	}
+
+	ESP_LOGI(TAG, "Uploaded %u RSSI histograms (%u samples untracked since boot)", count, (unsigned int)rssi_hist_untracked());
+	return count;
+}
+#endif
+
+#if defined(CONFIG_UPLOAD_TRANSPORT_UDP)
+
+static bool uploadReading(const ble_beacon_recived_t *rd)
+{
+	// Batched into datagrams, sent on flush or when a datagram fills
+	if (udp_add_reading(s_server, UDP_PORT, rd) == UDP_ERROR){
+		ESP_LOGE(TAG, "Failed to buffer reading");
+		return false;
+	}
+
+	return true;
+}
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+static bool uploadHistogram(const rssiHist_t *hist)
+{
+	uint8_t record[RECORD_HISTOGRAM_LEN(RSSI_HIST_BINS)];
+	int n;
+
+	n = record_pack_histogram(record, sizeof(record), hist);
+	if (udp_add_record(s_server, UDP_PORT, hist->deviceID, record, n) == UDP_ERROR){
+		ESP_LOGE(TAG, "Failed to buffer histogram");
+		return false;
+	}
+
+	return true;
+}
+#endif
+
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+static void uploadFingerprint(const fingerprint_t *fp)
+{
+	uint8_t record[RECORD_FINGERPRINT_LEN(FINGERPRINT_BEACONS)];
+	int n;
+
+	n = record_pack_fingerprint(record, sizeof(record), fp);
+	if (udp_add_record(s_server, UDP_PORT, fp->deviceID, record, n) == UDP_ERROR){
+		ESP_LOGE(TAG, "Failed to buffer fingerprint");
+	}
+}
+#endif
+
+static void uploadFlush(void)
+{
+	int n;
+
+	n = udp_flush(s_server, UDP_PORT);
+	if (n == UDP_ERROR){
+		ESP_LOGE(TAG, "Failed to reach collector");
+	} else if (n > 0){
+		ESP_LOGW(TAG, "%d datagrams awaiting retransmit", n);
+	} else {
+		ESP_LOGD(TAG, "Added enteries to database");
+	}
+
+#if defined(CONFIG_UPLOAD_COMPRESSION)
+	compress_stats_t stats;
+
+	compress_get_stats(&stats);
+	if (stats.batches > 0){
+		ESP_LOGI(TAG, "Compression: %u batches, %u -> %u bytes (%u%%), %u us last batch, %u us avg",
+			(unsigned int)stats.batches, (unsigned int)stats.rawBytes, (unsigned int)stats.compressedBytes,
+			(unsigned int)((uint64_t)stats.compressedBytes * 100 / stats.rawBytes),
+			(unsigned int)stats.lastCpuUs, (unsigned int)(stats.cpuUs / stats.batches));
+	}
+#endif
+}
+
+static void uploadDisconnect(void)
+{
+	// Datagrams awaiting an ack go to the new collector
+	udp_disconnect();
+}
+
+#elif defined(CONFIG_UPLOAD_TRANSPORT_UART)
+
+static bool uploadReading(const ble_beacon_recived_t *rd)
+{
+	uint8_t record[RECORD_PRESENCE_LEN];
+	int n;
+
+	// Queued for the UART driver, never waits on the wire
+	n = record_pack_reading(record, sizeof(record), rd);
+	if (uart_sink_send(rd->deviceID, record, n) == UART_SINK_ERROR){
+		ESP_LOGD(TAG, "UART TX buffer full, reading kept for the next cycle");
+		return false;
+	}
+
+	return true;
+}
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+static bool uploadHistogram(const rssiHist_t *hist)
+{
+	uint8_t record[RECORD_HISTOGRAM_LEN(RSSI_HIST_BINS)];
+	int n;
+
+	n = record_pack_histogram(record, sizeof(record), hist);
+	if (uart_sink_send(hist->deviceID, record, n) == UART_SINK_ERROR){
+		ESP_LOGE(TAG, "Failed to queue histogram");
+		return false;
+	}
+
+	return true;
+}
+#endif
+
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+static void uploadFingerprint(const fingerprint_t *fp)
+{
+	uint8_t record[RECORD_FINGERPRINT_LEN(FINGERPRINT_BEACONS)];
+	int n;
+
+	n = record_pack_fingerprint(record, sizeof(record), fp);
+	if (uart_sink_send(fp->deviceID, record, n) == UART_SINK_ERROR){
+		ESP_LOGE(TAG, "Failed to queue fingerprint");
+	}
+}
+#endif
+
+static void uploadFlush(void)
+{
+	uart_sink_stats_t stats;
+
+	uart_sink_get_stats(&stats);
+	if (stats.dropped > 0){
+		ESP_LOGW(TAG, "UART: %u frames (%u bytes), %u dropped", (unsigned int)stats.frames,
+			(unsigned int)stats.bytes, (unsigned int)stats.dropped);
+	}
+}
+
+static void uploadDisconnect(void)
+{
+	// Nothing to reconnect
+}
+
+#elif defined(CONFIG_UPLOAD_TRANSPORT_HTTPS)
+
+static bool uploadReading(const ble_beacon_recived_t *rd)
+{
+	char paramBuff[HTTP_VAR_BUFF_SIZE];
+	int status;
+
+	// Construct http request
+	if (record_query_sighting(paramBuff, HTTP_VAR_BUFF_SIZE, rd) == RECORD_ERROR){
+		// Would never fit, not worth keeping
+		ESP_LOGE(TAG, "Unable to construct HTTP request paramters. Too long?");
+		return true;
+	}
+
+	// Connection is kept open between readings, no need to wait in between
+	status = https_send_request(s_server, HTTPS_PORT, paramBuff);
+	if (http_should_resend(status)){
+		ESP_LOGE(TAG, "Failed to add entery to database, status %d", status);
+		return false;
+	}
+	if (status < 200 || status >= 300){
+		// Reached the server, sending it again could store it twice
+		ESP_LOGW(TAG, "Entery not confirmed, status %d", status);
+		return true;
+	}
+
+	ESP_LOGD(TAG, "Added entery to database");
+	return true;
+}
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+static bool uploadHistogram(const rssiHist_t *hist)
+{
+	char paramBuff[HTTP_HIST_BUFF_SIZE];
+	int status;
+
+	if (record_query_histogram(paramBuff, HTTP_HIST_BUFF_SIZE, hist) == RECORD_ERROR){
+		ESP_LOGE(TAG, "Unable to construct histogram request. Too long?");
+		return true;
+	}
+
+	status = https_send_request(s_server, HTTPS_PORT, paramBuff);
+	if (http_should_resend(status)){
+		ESP_LOGE(TAG, "Failed to upload histogram, status %d", status);
+		return false;
+	}
+	if (status < 200 || status >= 300){
+		ESP_LOGW(TAG, "Histogram not confirmed, status %d", status);
 	}
 
-}
\ No newline at end of file
+	return true;
+}
+#endif
+
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+static void uploadFingerprint(const fingerprint_t *fp)
+{
+	char paramBuff[HTTP_FP_BUFF_SIZE];
+	int status;
+
+	if (record_query_fingerprint(paramBuff, HTTP_FP_BUFF_SIZE, fp) == RECORD_ERROR){
+		ESP_LOGE(TAG, "Unable to construct fingerprint request. Too long?");
+		return;
+	}
+
+	status = https_send_request(s_server, HTTPS_PORT, paramBuff);
+	if (status < 200 || status >= 300){
+		ESP_LOGE(TAG, "Failed to upload fingerprint, status %d", status);
+	}
+}
+#endif
+
+static void uploadFlush(void)
+{
+	https_stats_t stats;
+
+	// Connection stays open until the server or a failure closes it
+	https_get_stats(&stats);
+	ESP_LOGI(TAG, "TLS: %u handshakes (%u of %u offered sessions resumed), avg %u ms, max %u ms, %u requests",
+		(unsigned int)stats.handshakes, (unsigned int)stats.resumed, (unsigned int)stats.resumeAttempts,
+		(unsigned int)(stats.handshakes ? stats.totalHandshakeUs / stats.handshakes / 1000 : 0),
+		(unsigned int)(stats.maxHandshakeUs / 1000), (unsigned int)stats.requests);
+}
+
+static void uploadDisconnect(void)
+{
+	https_close();
+}
+
+#else
+
+static bool uploadReading(const ble_beacon_recived_t *rd)
+{
+	char paramBuff[HTTP_VAR_BUFF_SIZE];
+	int status;
+
+	// Construct http request
+	if (record_query_sighting(paramBuff, HTTP_VAR_BUFF_SIZE, rd) == RECORD_ERROR){
+		// Would never fit, not worth keeping
+		ESP_LOGE(TAG, "Unable to construct HTTP request paramters. Too long?");
+		return true;
+	}
+
+	// Send over HTTP, only kept for another try if it never reached the server or was
+	// turned away, a slow response (0) has usually been stored already
+	status = http_send_request(s_server, HTTP_PORT, paramBuff);
+	if (http_should_resend(status)){
+		ESP_LOGE(TAG, "Failed to add entery to database, status %d", status);
+		return false;
+	}
+	if (status < 200 || status >= 300){
+		ESP_LOGW(TAG, "Entery not confirmed, status %d", status);
+		return true;
+	}
+
+	ESP_LOGD(TAG, "Added entery to database");
+	// Requests are spaced by the pacer's token bucket
+	return true;
+}
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+static bool uploadHistogram(const rssiHist_t *hist)
+{
+	char paramBuff[HTTP_HIST_BUFF_SIZE];
+	int status;
+
+	if (record_query_histogram(paramBuff, HTTP_HIST_BUFF_SIZE, hist) == RECORD_ERROR){
+		ESP_LOGE(TAG, "Unable to construct histogram request. Too long?");
+		return true;
+	}
+
+	status = http_send_request(s_server, HTTP_PORT, paramBuff);
+	if (http_should_resend(status)){
+		ESP_LOGE(TAG, "Failed to upload histogram, status %d", status);
+		return false;
+	}
+	if (status < 200 || status >= 300){
+		ESP_LOGW(TAG, "Histogram not confirmed, status %d", status);
+	}
+
+	return true;
+}
+#endif
+
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+static void uploadFingerprint(const fingerprint_t *fp)
+{
+	char paramBuff[HTTP_FP_BUFF_SIZE];
+
+	if (record_query_fingerprint(paramBuff, HTTP_FP_BUFF_SIZE, fp) == RECORD_ERROR){
+		ESP_LOGE(TAG, "Unable to construct fingerprint request. Too long?");
+		return;
+	}
+
+	if (http_send_request(s_server, HTTP_PORT, paramBuff) == HTTP_ERROR){
+		ESP_LOGE(TAG, "Failed to upload fingerprint");
+	}
+}
+#endif
+
+static void uploadFlush(void)
+{
+	// Every reading is its own request
+}
+
+static void uploadDisconnect(void)
+{
+	// Every request resolves the address again
+}
+
+#endif
@@ -12,7 +12,23 @@
 #ifndef DATABASEAPP_H
 #define DATABASEAPP_H
 
+/**
+ * @brief Upload task, used on dual core targets so uploading runs beside scanning
+ * 
+ * @param pvParameters 
+ */
 void vDatabaseContact(void *pvParameters);
+
+/**
+ * @brief Wakes vDatabaseContact, called when a scan finishes
+ * 
+ */
+void databaseNotify();
+
+/**
+ * @brief Uploads everything waiting in the beacon handoff
+ * 
+ */
 void databaseContact();
 
 #endif
\ No newline at end of file
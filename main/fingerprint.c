@@ -0,0 +1,122 @@
+/**
+ * @file fingerprint.c
+ * @author Flynn Harrison
+ * @brief Dense per scan RSSI fingerprints for localisation
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "fingerprint.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "allowlist.h"
+
+// Sums for the scan in progress, written by the GAP callback and read out by the scan
+// task once the scan has stopped. The finished fingerprint waits in s_ready for the
+// uploader, a newer one replaces it.
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static int32_t s_sum[FINGERPRINT_BEACONS];
+static uint16_t s_count[FINGERPRINT_BEACONS];
+static uint16_t s_packetGroup;
+static int8_t s_deviceID;
+static bool s_any;
+static fingerprint_t s_ready;
+static bool s_readyValid;
+static fingerprint_stats_t s_stats;
+
+void fingerprint_add(const ble_beacon_recived_t *rd)
+{
+	int pos = allowlist_position(ble_beacon_key(rd));
+
+	if (pos == ALLOWLIST_NOT_FOUND)
+	{
+		return;
+	}
+
+	taskENTER_CRITICAL(&s_lock);
+	if (pos >= FINGERPRINT_BEACONS)
+	{
+		s_stats.outside++;
+	}
+	else if (s_count[pos] < UINT16_MAX)
+	{
+		s_sum[pos] += rd->rssi;
+		s_count[pos]++;
+		s_packetGroup = rd->packetGroup;
+		s_deviceID = rd->deviceID;
+		s_any = true;
+	}
+	taskEXIT_CRITICAL(&s_lock);
+}
+
+void fingerprint_end(void)
+{
+	uint32_t slots = allowlist_count();
+	fingerprint_t *fp = &s_ready;
+
+	if (slots > FINGERPRINT_BEACONS)
+	{
+		slots = FINGERPRINT_BEACONS;
+	}
+
+	taskENTER_CRITICAL(&s_lock);
+	if (!s_any)
+	{
+		s_stats.empty++;
+		taskEXIT_CRITICAL(&s_lock);
+		return;
+	}
+
+	s_stats.replaced += s_readyValid;
+	s_stats.built++;
+	memset(fp, 0, sizeof(*fp));
+	fp->packetGroup = s_packetGroup;
+	fp->deviceID = s_deviceID;
+	fp->slots = (uint8_t)slots;
+	fp->orderHash = allowlist_order_hash();
+	for (uint32_t i = 0; i < slots; i++)
+	{
+		if (s_count[i] > 0)
+		{
+			// Rounded to the nearest dBm, halves away from zero for the usual negative values
+			fp->rssi[i] = (int8_t)((2 * s_sum[i] - s_count[i]) / (2 * s_count[i]));
+			fp->heard[i / 8] |= 1 << (i % 8);
+		}
+	}
+	s_readyValid = true;
+
+	memset(s_sum, 0, sizeof(s_sum));
+	memset(s_count, 0, sizeof(s_count));
+	s_any = false;
+	taskEXIT_CRITICAL(&s_lock);
+}
+
+bool fingerprint_take(fingerprint_t *fp)
+{
+	bool valid;
+
+	taskENTER_CRITICAL(&s_lock);
+	valid = s_readyValid;
+	if (valid)
+	{
+		*fp = s_ready;
+		s_readyValid = false;
+	}
+	taskEXIT_CRITICAL(&s_lock);
+
+	return valid;
+}
+
+void fingerprint_get_stats(fingerprint_stats_t *stats)
+{
+	taskENTER_CRITICAL(&s_lock);
+	*stats = s_stats;
+	taskEXIT_CRITICAL(&s_lock);
+}
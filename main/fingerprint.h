@@ -0,0 +1,72 @@
+/**
+ * @file fingerprint.h
+ * @author Flynn Harrison
+ * @brief Dense per scan RSSI fingerprints for localisation. Every scan result of a
+ * provisioned beacon is averaged into the beacon's allowlist slot, the finished
+ * fingerprint is handed to the uploader at the end of the scan.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "beaconBLE.h"
+#include "sdkconfig.h"
+
+#define FINGERPRINT_BEACONS     CONFIG_FINGERPRINT_BEACONS
+#define FINGERPRINT_BITMAP_LEN  ((FINGERPRINT_BEACONS + 7) / 8)
+
+typedef struct {
+	uint16_t packetGroup;			// Scan, same as the sightings from it
+	int8_t deviceID;
+	uint8_t slots;					// Provisioned beacons covered, at most FINGERPRINT_BEACONS
+	uint32_t orderHash;				// allowlist_order_hash() the slots follow
+	uint8_t heard[FINGERPRINT_BITMAP_LEN];	// Bit i % 8 of byte i / 8 set if slot i was heard
+	int8_t rssi[FINGERPRINT_BEACONS];		// Mean over the scan, 0 where not heard
+} fingerprint_t;
+
+typedef struct {
+	uint32_t built;					// Fingerprints with at least one beacon heard
+	uint32_t empty;					// Scans that heard no provisioned beacon, nothing uploaded
+	uint32_t replaced;				// Built before the last one was uploaded, the older one is lost
+	uint32_t outside;				// Scan results of beacons past FINGERPRINT_BEACONS
+} fingerprint_stats_t;
+
+/**
+ * @brief Adds a scan result to the current fingerprint (GAP callback)
+ * 
+ * @param rd reading with rssi, packetGroup and deviceID filled in
+ */
+void fingerprint_add(const ble_beacon_recived_t *rd);
+
+/**
+ * @brief Finishes the current fingerprint (scan task, once the scan has stopped) and
+ * starts the next one
+ * 
+ */
+void fingerprint_end(void);
+
+/**
+ * @brief Takes the last finished fingerprint (upload path)
+ * 
+ * @param fp
+ * @return true
+ * @return false nothing new since the last call
+ */
+bool fingerprint_take(fingerprint_t *fp);
+
+/**
+ * @brief Counters since boot
+ * 
+ * @param stats
+ */
+void fingerprint_get_stats(fingerprint_stats_t *stats);
+
+#endif
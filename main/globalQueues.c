@@ -0,0 +1,360 @@
+/**
+ * @file globalQueues.c
+ * @author Flynn Harrison
+ * @brief Handoff for detected beacons
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "globalQueues.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#if defined(CONFIG_FREERTOS_UNICORE)
+#include "freertos/queue.h"
+#endif
+
+#include "spscRing.h"
+#include "beaconList.h"
+
+#define BEACON_QUEUE_LEN CONFIG_BEACON_QUEUE_LEN
+// A whole scan's readings fit, the uploader collects them once the scan is done
+#define BEACON_HANDOFF_LEN (BEACON_QUEUE_LEN > BEACON_LIST_SIZE ? BEACON_QUEUE_LEN : BEACON_LIST_SIZE)
+
+// Reading as it crosses from the GAP callback, stamped on the producer side
+typedef struct {
+	ble_beacon_recived_t rd;
+	int64_t queuedUs;
+} beacon_handoff_item_t;
+
+typedef struct {
+	ble_beacon_recived_t rd;
+	int64_t queuedUs;			// When the reading was sent (refreshed on coalesce)
+	int64_t firstQueuedUs;		// When the oldest reading coalesced into this slot was sent
+	bool pending;
+} beacon_slot_t;
+
+#if defined(CONFIG_FREERTOS_UNICORE)
+
+static QueueHandle_t beaconQueueHandle = NULL;	// evil global (not so global anymore)
+
+#if defined(CONFIG_STATIC_ALLOCATION)
+static uint8_t beaconQueueStorage[BEACON_HANDOFF_LEN * sizeof(beacon_handoff_item_t)];
+static StaticQueue_t beaconQueueBuffer;
+#endif
+
+static esp_err_t handoffInit(void)
+{
+	if (beaconQueueHandle != NULL){
+		xQueueReset(beaconQueueHandle);
+		return ESP_OK;
+	}
+#if defined(CONFIG_STATIC_ALLOCATION)
+	beaconQueueHandle = xQueueCreateStatic(BEACON_HANDOFF_LEN, sizeof(beacon_handoff_item_t), beaconQueueStorage, &beaconQueueBuffer);
+#else
+	beaconQueueHandle = xQueueCreate(BEACON_HANDOFF_LEN, sizeof(beacon_handoff_item_t));
+#endif
+
+	return beaconQueueHandle == NULL ? ESP_ERR_NO_MEM : ESP_OK;
+}
+
+static bool handoffPush(const beacon_handoff_item_t *item)
+{
+	return xQueueSend(beaconQueueHandle, item, 0) == pdTRUE;
+}
+
+static bool handoffPop(beacon_handoff_item_t *item)
+{
+	return xQueueReceive(beaconQueueHandle, item, 0) == pdPASS;
+}
+
+static uint32_t handoffCount(void)
+{
+	return uxQueueMessagesWaiting(beaconQueueHandle);
+}
+
+#else
+
+// Producer is the Bluedroid task on the scan core, consumer the upload task on the other
+static uint8_t beaconRingStorage[SPSC_RING_STORAGE_SIZE(BEACON_HANDOFF_LEN, sizeof(beacon_handoff_item_t))];
+static spscRing_t beaconRing;
+
+static esp_err_t handoffInit(void)
+{
+	spscRingInit(&beaconRing, beaconRingStorage, BEACON_HANDOFF_LEN, sizeof(beacon_handoff_item_t));
+	return ESP_OK;
+}
+
+static bool handoffPush(const beacon_handoff_item_t *item)
+{
+	return spscRingPush(&beaconRing, item);
+}
+
+static bool handoffPop(beacon_handoff_item_t *item)
+{
+	return spscRingPop(&beaconRing, item);
+}
+
+static uint32_t handoffCount(void)
+{
+	return spscRingCount(&beaconRing);
+}
+
+#endif
+
+// One slot per beacon, only ever touched by the uploader so coalescing costs the GAP
+// callback nothing. The lock only keeps the counters consistent for other readers.
+static beacon_slot_t beaconBacklog[BEACON_QUEUE_LEN];
+static portMUX_TYPE beaconBacklogLock = portMUX_INITIALIZER_UNLOCKED;
+static beaconHandoff_stats_t beaconBacklogStats;
+static uint32_t beaconBacklogLen = BEACON_QUEUE_LEN;	// Slots new readings may take, set from the scan task
+static uint32_t beaconHandoffDropped;					// Counted by the producer, atomically
+static beacon_slot_t beaconBacklogTaken;				// Last reading taken, for beaconHandoffRequeue()
+
+esp_err_t beaconHandoffInit(void)
+{
+	for (int i = 0; i < BEACON_QUEUE_LEN; i++)
+	{
+		beaconBacklog[i].pending = false;
+	}
+	beaconBacklogStats = (beaconHandoff_stats_t){ 0 };
+	beaconHandoffDropped = 0;
+
+	return handoffInit();
+}
+
+bool beaconHandoffSend(const ble_beacon_recived_t *rd)
+{
+	beacon_handoff_item_t item = {
+		.rd = *rd,
+		.queuedUs = esp_timer_get_time(),
+	};
+
+	if (!handoffPush(&item))
+	{
+		__atomic_fetch_add(&beaconHandoffDropped, 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Coalesces a reading into the backlog (uploader only)
+ * 
+ * @param in reading with its send times
+ * @param requeued taken earlier and not delivered, a newer reading of the beacon wins
+ */
+static void beaconBacklogAdd(const beacon_slot_t *in, bool requeued)
+{
+	uint32_t key = ble_beacon_key(&in->rd);
+	uint32_t len = __atomic_load_n(&beaconBacklogLen, __ATOMIC_RELAXED);
+	beacon_slot_t *slot = NULL;
+	beacon_slot_t *empty = NULL;
+	beacon_slot_t *stalest = NULL;
+	bool coalesced = false;
+	bool evicted = false;
+
+	// A shrunk length still leaves readings waiting above it, they are matched too
+	for (uint32_t i = 0; i < BEACON_QUEUE_LEN; i++)
+	{
+		if (!beaconBacklog[i].pending)
+		{
+			empty = empty == NULL && i < len ? &beaconBacklog[i] : empty;
+		}
+		else if (ble_beacon_key(&beaconBacklog[i].rd) == key)
+		{
+			slot = &beaconBacklog[i];
+			break;
+		}
+		else if (i < len && (stalest == NULL || beaconBacklog[i].queuedUs < stalest->queuedUs))
+		{
+			stalest = &beaconBacklog[i];
+		}
+	}
+
+	if (slot != NULL)
+	{
+		// Still waiting from an earlier scan, the newer reading stays
+		coalesced = true;
+		if (!requeued)
+		{
+			slot->rd = in->rd;
+			slot->queuedUs = in->queuedUs;
+		}
+		else if (in->firstQueuedUs < slot->firstQueuedUs)
+		{
+			slot->firstQueuedUs = in->firstQueuedUs;
+		}
+	}
+	else if (empty == NULL && requeued && in->queuedUs < stalest->queuedUs)
+	{
+		// Full of fresher readings, the one put back is the stalest
+		evicted = true;
+	}
+	else
+	{
+		if (empty != NULL)
+		{
+			slot = empty;
+		}
+		else
+		{
+			// More beacons than slots, the stalest reading makes way for the fresh one
+			slot = stalest;
+			evicted = true;
+		}
+		*slot = *in;
+		slot->pending = true;
+	}
+
+	taskENTER_CRITICAL(&beaconBacklogLock);
+	if (requeued)
+	{
+		beaconBacklogStats.requeued++;
+	}
+	else
+	{
+		beaconBacklogStats.received++;
+	}
+	beaconBacklogStats.coalesced += coalesced;
+	beaconBacklogStats.evicted += evicted;
+	taskEXIT_CRITICAL(&beaconBacklogLock);
+}
+
+void beaconHandoffCollect(void)
+{
+	beacon_handoff_item_t item;
+	beacon_slot_t in;
+
+	while (handoffPop(&item))
+	{
+		in.rd = item.rd;
+		in.queuedUs = item.queuedUs;
+		in.firstQueuedUs = item.queuedUs;
+		beaconBacklogAdd(&in, false);
+	}
+}
+
+bool beaconHandoffReceive(ble_beacon_recived_t *rd)
+{
+	int64_t now = esp_timer_get_time();
+	beacon_slot_t *freshest = NULL;
+	uint32_t age;
+	uint32_t wait;
+
+	beaconHandoffCollect();
+
+	for (int i = 0; i < BEACON_QUEUE_LEN; i++)
+	{
+		if (beaconBacklog[i].pending && (freshest == NULL || beaconBacklog[i].queuedUs > freshest->queuedUs))
+		{
+			freshest = &beaconBacklog[i];
+		}
+	}
+
+	if (freshest == NULL)
+	{
+		return false;
+	}
+
+	*rd = freshest->rd;
+	beaconBacklogTaken = *freshest;
+	freshest->pending = false;
+
+	age = (uint32_t)(now - freshest->queuedUs);
+	// How long the beacon has been waiting for an upload, however often it was refreshed
+	wait = (uint32_t)(now - freshest->firstQueuedUs);
+
+	taskENTER_CRITICAL(&beaconBacklogLock);
+	beaconBacklogStats.delivered++;
+	beaconBacklogStats.totalAgeUs += age;
+	if (age > beaconBacklogStats.maxAgeUs)
+	{
+		beaconBacklogStats.maxAgeUs = age;
+	}
+	if (wait > beaconBacklogStats.maxWaitUs)
+	{
+		beaconBacklogStats.maxWaitUs = wait;
+	}
+	taskEXIT_CRITICAL(&beaconBacklogLock);
+
+	return true;
+}
+
+bool beaconHandoffTake(ble_beacon_recived_t *rd, int64_t *queuedUs)
+{
+	beacon_handoff_item_t item;
+	uint32_t age;
+
+	if (!handoffPop(&item))
+	{
+		return false;
+	}
+
+	*rd = item.rd;
+	*queuedUs = item.queuedUs;
+	age = (uint32_t)(esp_timer_get_time() - item.queuedUs);
+
+	taskENTER_CRITICAL(&beaconBacklogLock);
+	beaconBacklogStats.received++;
+	beaconBacklogStats.delivered++;
+	beaconBacklogStats.totalAgeUs += age;
+	if (age > beaconBacklogStats.maxAgeUs)
+	{
+		beaconBacklogStats.maxAgeUs = age;
+	}
+	if (age > beaconBacklogStats.maxWaitUs)
+	{
+		beaconBacklogStats.maxWaitUs = age;
+	}
+	taskEXIT_CRITICAL(&beaconBacklogLock);
+
+	return true;
+}
+
+void beaconHandoffRequeue(const ble_beacon_recived_t *rd)
+{
+	beacon_slot_t in = beaconBacklogTaken;
+
+	if (ble_beacon_key(rd) != ble_beacon_key(&in.rd))
+	{
+		in.queuedUs = esp_timer_get_time();
+		in.firstQueuedUs = in.queuedUs;
+	}
+	in.rd = *rd;
+
+	// Anything newer sent meanwhile has to be in the backlog to win over it
+	beaconHandoffCollect();
+	beaconBacklogAdd(&in, true);
+}
+
+void beaconHandoffSetLength(uint32_t len)
+{
+	__atomic_store_n(&beaconBacklogLen, len < 1 ? 1 : len > BEACON_QUEUE_LEN ? BEACON_QUEUE_LEN : len, __ATOMIC_RELAXED);
+}
+
+uint32_t beaconHandoffWaiting(void)
+{
+	uint32_t waiting = handoffCount();
+
+	for (int i = 0; i < BEACON_QUEUE_LEN; i++)
+	{
+		waiting += beaconBacklog[i].pending;
+	}
+
+	return waiting;
+}
+
+void beaconHandoffGetStats(beaconHandoff_stats_t *stats)
+{
+	taskENTER_CRITICAL(&beaconBacklogLock);
+	*stats = beaconBacklogStats;
+	taskEXIT_CRITICAL(&beaconBacklogLock);
+	stats->dropped = __atomic_load_n(&beaconHandoffDropped, __ATOMIC_RELAXED);
+}
@@ -9,16 +9,107 @@
  * 
  */
 
-#include "freertos/queue.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "beaconBLE.h"
 
 #ifndef GLOBALQUEUES_H
 #define GLOBALQUEUES_H
 
+typedef struct {
+	uint32_t received;			// Readings collected into the backlog
+	uint32_t dropped;			// Handoff full, the uploader fell a whole handoff behind
+	uint32_t coalesced;			// Replaced a reading of the same beacon still waiting
+	uint32_t evicted;			// Stalest reading dropped to make room, more beacons than slots
+	uint32_t delivered;			// Readings taken by the uploader
+	uint32_t requeued;			// Of those, put back because the upload failed
+	uint64_t totalAgeUs;		// Sum of reading ages when taken
+	uint32_t maxAgeUs;			// Oldest reading taken
+	uint32_t maxWaitUs;			// Longest a beacon waited for upload, across coalescing
+} beaconHandoff_stats_t;
+
 /**
- * @brief Queue for detected beacons
+ * @brief Handoff for detected beacons, from the GAP callback to the uploader.
+ * Readings are copied in by value. On single core targets this is a FreeRTOS
+ * queue, on dual core targets a lock free ring so the scan core never waits on
+ * the upload core. The uploader collects them into a backlog holding at most one
+ * reading per beacon, when uploads lag a newer reading replaces the waiting one
+ * rather than being dropped, and it takes the freshest first.
  * -Yes it does feel dirty
  * 
  */
-extern QueueHandle_t beaconQueueHandle;
+esp_err_t beaconHandoffInit(void);
+
+/**
+ * @brief Adds a reading, never blocks (GAP callback only)
+ * 
+ * @param rd 
+ * @return true 
+ * @return false full, the uploader has fallen more than a scan behind
+ */
+bool beaconHandoffSend(const ble_beacon_recived_t *rd);
+
+/**
+ * @brief Moves sent readings into the backlog, never blocks (uploader only). A
+ * reading replaces one of the same beacon that is still waiting, or when every
+ * slot holds another beacon, the stalest reading. Call it while uploads are held
+ * off so the handoff keeps draining.
+ * 
+ */
+void beaconHandoffCollect(void);
+
+/**
+ * @brief Collects, then takes the freshest reading, never blocks (uploader only)
+ * 
+ * @param rd 
+ * @return true 
+ * @return false empty
+ */
+bool beaconHandoffReceive(ble_beacon_recived_t *rd);
+
+/**
+ * @brief Takes the oldest sent reading as it is, bypassing the backlog, never
+ * blocks (uploader only). For consumers that need every scan's reading.
+ * 
+ * @param rd 
+ * @param queuedUs when it was sent, close to when the beacon was heard
+ * @return true 
+ * @return false empty
+ */
+bool beaconHandoffTake(ble_beacon_recived_t *rd, int64_t *queuedUs);
+
+/**
+ * @brief Puts back a reading just taken that could not be uploaded, unless a newer
+ * reading of the same beacon has arrived since (uploader only). It keeps its age,
+ * so it is taken again after fresher readings and evicted before them.
+ * 
+ * @param rd 
+ */
+void beaconHandoffRequeue(const ble_beacon_recived_t *rd);
+
+/**
+ * @brief Limits new readings to the first len backlog slots (at most
+ * CONFIG_BEACON_QUEUE_LEN). Readings already waiting in the other slots are still delivered,
+ * and coalesced with newer readings of their beacon.
+ * 
+ * @param len 
+ */
+void beaconHandoffSetLength(uint32_t len);
+
+/**
+ * @brief Readings waiting, in the handoff or the backlog (uploader only)
+ * 
+ * @return uint32_t 
+ */
+uint32_t beaconHandoffWaiting(void);
+
+/**
+ * @brief Coalescing and age counters since boot
+ * 
+ * @param stats 
+ */
+void beaconHandoffGetStats(beaconHandoff_stats_t *stats);
 
-#endif
\ No newline at end of file
+#endif
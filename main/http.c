@@ -12,27 +12,41 @@
 #include "http.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 
+#include "profile.h"
+#include "pacer.h"
+#include "params.h"
+#include "record.h"
+
 #include "lwip/err.h"
 #include "lwip/sockets.h"
 #include "lwip/sys.h"
 #include "lwip/netdb.h"
 #include "lwip/dns.h"
 
-#define TXBUFF_SIZE 100
+// Request line and Host header around the longest record query and collector address
+#define TXBUFF_SIZE (sizeof("POST / HTTP/1.0\r\nHost: :65535\r\n\r\n") + RECORD_QUERY_MAX + PARAM_STR_MAX)
+#define RXBUFF_SIZE 384
+#define RESPONSE_TIMEOUT_MS 500
 
 #define HTTP_PORT "80"
 
 static const char TAG[] = "HTTP api";
 
+static int http_read_status(int s);
+
 int http_send_request(const char* url, const char* port, const char* path)
 {
 	struct addrinfo *res;
 	int err, s, n;
+	int status;
 	char txBuff[TXBUFF_SIZE];
 
 	// Configure socket type
@@ -49,9 +63,17 @@ int http_send_request(const char* url, const char* port, const char* path)
 		return HTTP_ERROR;
 	}
 
+	// Token first, no socket is held open on the server while waiting for it
+	pacer_wait();
+	if (pacer_holding()){
+		return HTTP_ERROR;
+	}
+
 	// DNS lookup
 	// If it fails then there might not be a internet connection
+	PROFILE_BEGIN(PROFILE_DNS);
 	err = getaddrinfo(url, port, &hints, &res);
+	PROFILE_END(PROFILE_DNS);
 	if (err != 0){
 		ESP_LOGE(TAG, "DNS lookup failed");
 		return HTTP_ERROR;
@@ -67,7 +89,10 @@ int http_send_request(const char* url, const char* port, const char* path)
 	}
 
 	// Connect to server
-	if (connect(s, res->ai_addr, res->ai_addrlen) != 0){
+	PROFILE_BEGIN(PROFILE_CONNECT);
+	err = connect(s, res->ai_addr, res->ai_addrlen);
+	PROFILE_END(PROFILE_CONNECT);
+	if (err != 0){
 		ESP_LOGE(TAG, "Failed to connect to server %s", url);
 		close(s);
 		freeaddrinfo(res);
@@ -76,7 +101,10 @@ int http_send_request(const char* url, const char* port, const char* path)
 
 	freeaddrinfo(res);
 
-	if (write(s, txBuff, n) < 0 ){
+	PROFILE_BEGIN(PROFILE_WRITE);
+	n = write(s, txBuff, n);
+	PROFILE_END(PROFILE_WRITE);
+	if (n < 0 ){
 		ESP_LOGE(TAG, "Failed to write to socket");
 		close(s);
 		return HTTP_ERROR;
@@ -84,10 +112,114 @@ int http_send_request(const char* url, const char* port, const char* path)
 
 	ESP_LOGD(TAG, "HTTP request sent");
 
-	// Currently dont care about http response
-	vTaskDelay(50 / portTICK_PERIOD_MS);
+	// Only the headers matter (status and rate hints), the body is ignored
+	PROFILE_BEGIN(PROFILE_READ);
+	status = http_read_status(s);
+	PROFILE_END(PROFILE_READ);
 	close(s);
 
-	return 1;
+	if (status == 429 || status == 503){
+		ESP_LOGW(TAG, "Server busy, status %d", status);
+	}
+
+	return status;
+}
+
+/**
+ * @brief Reads the status line and headers, giving up after RESPONSE_TIMEOUT_MS
+ * 
+ * @param s connected socket
+ * @return int status code, or 0 if no complete headers arrived in time
+ */
+static int http_read_status(int s)
+{
+	char rxBuff[RXBUFF_SIZE];
+	struct timeval tv = {
+		.tv_sec = RESPONSE_TIMEOUT_MS / 1000,
+		.tv_usec = (RESPONSE_TIMEOUT_MS % 1000) * 1000,
+	};
+	size_t len = 0;
+	char *end = NULL;
+	int status;
+	int n;
+
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	while (end == NULL && len < RXBUFF_SIZE - 1)
+	{
+		n = recv(s, &rxBuff[len], RXBUFF_SIZE - 1 - len, 0);
+		if (n <= 0){
+			return 0;
+		}
+		len += n;
+		rxBuff[len] = '\0';
+		end = strstr(rxBuff, "\r\n\r\n");
+	}
+
+	if (end == NULL || sscanf(rxBuff, "HTTP/1.%*d %d", &status) != 1){
+		return 0;
+	}
+
+	http_apply_rate_hints(rxBuff, end);
+	http_apply_params(rxBuff, end);
+	return status;
+}
+
+bool http_should_resend(int status)
+{
+	return status == HTTP_ERROR || status == 429 || status == 503;
+}
+
+const char *http_find_header(const char *buf, const char *end, const char *name)
+{
+	size_t nameLen = strlen(name);
+	const char *line = strstr(buf, "\r\n");
+
+	while (line != NULL && line < end)
+	{
+		line += 2;
+		if (strncasecmp(line, name, nameLen) == 0){
+			return line + nameLen;
+		}
+		line = strstr(line, "\r\n");
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Seconds in a header value to ms, saturating rather than wrapping into a short
+ * hold off (the pacer caps it further)
+ * 
+ * @param value 
+ * @return uint32_t 
+ */
+static uint32_t http_hint_ms(const char *value)
+{
+	unsigned long s = strtoul(value, NULL, 10);
+
+	return s > UINT32_MAX / 1000 ? UINT32_MAX : s * 1000;
 }
 
+void http_apply_rate_hints(const char *buf, const char *end)
+{
+	const char *hdr;
+	const char *reset;
+
+	// Retry-After in seconds (the HTTP date form is not used by our collector)
+	if ((hdr = http_find_header(buf, end, "Retry-After:")) != NULL){
+		pacer_hold_off(http_hint_ms(hdr));
+	}
+	else if ((hdr = http_find_header(buf, end, "RateLimit-Remaining:")) != NULL && strtol(hdr, NULL, 10) == 0 &&
+		(reset = http_find_header(buf, end, "RateLimit-Reset:")) != NULL){
+		pacer_hold_off(http_hint_ms(reset));
+	}
+}
+
+void http_apply_params(const char *buf, const char *end)
+{
+	const char *hdr;
+
+	if ((hdr = http_find_header(buf, end, "X-Receiver-Params:")) != NULL){
+		params_push(hdr);
+	}
+}
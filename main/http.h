@@ -12,8 +12,57 @@
 #ifndef HTTP_H
 #define HTTP_H
 
+#include <stdbool.h>
+
 #define HTTP_ERROR -1
 
+/**
+ * @brief Sends a POST and reads the response headers for rate hints
+ * 
+ * @param url 
+ * @param port 
+ * @param path 
+ * @return int status code, 0 if the server did not answer in time, or HTTP_ERROR if
+ * the request was not sent
+ */
 int http_send_request(const char* url, const char* port, const char* path);
 
+/**
+ * @brief Whether a request should be sent again later: it never reached the server
+ * (HTTP_ERROR) or the server turned it away (429, 503). Anything else, no status in
+ * time included, may already be stored, sending it again would store it twice.
+ * 
+ * @param status from http_send_request() or https_send_request()
+ * @return true 
+ * @return false 
+ */
+bool http_should_resend(int status);
+
+/**
+ * @brief Finds a header (case insensitive) between the status line and end
+ * 
+ * @param buf response, starting with the status line
+ * @param end end of the headers
+ * @param name including the colon
+ * @return const char* start of the value or NULL
+ */
+const char *http_find_header(const char *buf, const char *end, const char *name);
+
+/**
+ * @brief Passes Retry-After, or RateLimit-Reset once RateLimit-Remaining reaches 0,
+ * on to the upload pacer
+ * 
+ * @param buf response, starting with the status line
+ * @param end end of the headers
+ */
+void http_apply_rate_hints(const char *buf, const char *end);
+
+/**
+ * @brief Stages parameters pushed in an X-Receiver-Params header (see params.h)
+ * 
+ * @param buf response, starting with the status line
+ * @param end end of the headers
+ */
+void http_apply_params(const char *buf, const char *end);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,463 @@
+/**
+ * @file https.c
+ * @author Flynn Harrison
+ * @brief HTTPS requests over a kept alive TLS connection
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "https.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_tls.h"
+#include "lwip/sockets.h"
+#include "sdkconfig.h"
+
+#include "profile.h"
+#include "pacer.h"
+#include "http.h"
+#include "params.h"
+#include "record.h"
+
+// Request headers around the longest record query and collector address
+#define TXBUFF_SIZE (sizeof("POST / HTTP/1.1\r\nHost: :65535\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n") + RECORD_QUERY_MAX + PARAM_STR_MAX)
+#define RXBUFF_SIZE 512
+#define HTTPS_TIMEOUT_MS CONFIG_UPLOAD_HTTPS_TIMEOUT_MS
+
+// Same CA that is used for EAP
+extern const uint8_t ca_pem_start[] asm("_binary_ca_pem_start");
+extern const uint8_t ca_pem_end[]   asm("_binary_ca_pem_end");
+
+static const char TAG[] = "HTTPS api";
+
+static esp_tls_t *s_tls = NULL;
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+static esp_tls_client_session_t *s_session = NULL;
+static bool s_saveSession = false;		// Fresh connection, save its session once a response is in
+static uint32_t s_fullHandshakeUs;		// Last handshake judged full, resumptions are timed against it
+#endif
+static https_stats_t s_stats;
+
+// Response bytes read but not consumed yet are s_rxBuff[s_rxPos..s_rxLen)
+static char s_rxBuff[RXBUFF_SIZE];
+static size_t s_rxPos;
+static size_t s_rxLen;
+
+static int https_connect(const char* url, const char* port);
+static bool https_stale(void);
+static int https_read_response(void);
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+static bool https_resumed(bool offered, uint32_t durationUs);
+static void https_save_session(void);
+#endif
+
+int https_send_request(const char* url, const char* port, const char* path)
+{
+	char txBuff[TXBUFF_SIZE];
+	bool reused;
+	int n;
+	int status;
+
+	n = snprintf(txBuff, TXBUFF_SIZE, "POST /%s HTTP/1.1\r\nHost: %s:%s\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n", path, url, port);
+	if (n < 0 || n >= TXBUFF_SIZE){
+		ESP_LOGE(TAG, "Request construction failed, n: %d", n);
+		return HTTPS_ERROR;
+	}
+
+	// Token first, a fresh connection is not opened (and held on the server) while waiting for it
+	pacer_wait();
+	if (pacer_holding()){
+		return HTTPS_ERROR;
+	}
+
+	// A kept connection the server has closed since is replaced before writing
+	if (s_tls != NULL && https_stale()){
+		ESP_LOGD(TAG, "Server closed the connection, reconnecting");
+		https_close();
+	}
+
+	// Reuse the connection. A write that fails on it was not received, so it is sent
+	// once more on a fresh one. Nothing is sent twice once a write has gone through.
+	for (;;)
+	{
+		reused = s_tls != NULL;
+		if (!reused && https_connect(url, port) == HTTPS_ERROR){
+			return HTTPS_ERROR;
+		}
+
+		PROFILE_BEGIN(PROFILE_WRITE);
+		status = esp_tls_conn_write(s_tls, txBuff, n);
+		PROFILE_END(PROFILE_WRITE);
+		if (status == n){
+			break;
+		}
+
+		https_close();
+		if (!reused){
+			ESP_LOGE(TAG, "Failed to send request to %s", url);
+			return HTTPS_ERROR;
+		}
+		ESP_LOGD(TAG, "Connection lost, reconnecting");
+	}
+	s_stats.requests++;
+
+	PROFILE_BEGIN(PROFILE_READ);
+	status = https_read_response();
+	PROFILE_END(PROFILE_READ);
+	if (status == HTTPS_ERROR){
+		// The server may have stored it already, not sent again
+		ESP_LOGW(TAG, "No response from %s", url);
+		https_close();
+		return 0;
+	}
+
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+	https_save_session();
+#endif
+	return status;
+}
+
+void https_close(void)
+{
+	if (s_tls != NULL){
+		esp_tls_conn_destroy(s_tls);
+		s_tls = NULL;
+	}
+}
+
+void https_get_stats(https_stats_t *stats)
+{
+	*stats = s_stats;
+}
+
+static int https_connect(const char* url, const char* port)
+{
+	int64_t start;
+	uint32_t duration;
+	int n;
+
+	esp_tls_cfg_t cfg = {
+		.cacert_buf = ca_pem_start,
+		.cacert_bytes = ca_pem_end - ca_pem_start,
+		.timeout_ms = HTTPS_TIMEOUT_MS,
+	};
+
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+	// Offer the last session, the server may resume it instead of a full handshake
+	if (s_session != NULL){
+		cfg.client_session = s_session;
+		s_stats.resumeAttempts++;
+	}
+#endif
+
+	s_tls = esp_tls_init();
+	if (s_tls == NULL){
+		ESP_LOGE(TAG, "Failed to allocate TLS connection");
+		return HTTPS_ERROR;
+	}
+
+	// DNS is part of the handshake span here
+	start = esp_timer_get_time();
+	PROFILE_BEGIN(PROFILE_CONNECT);
+	n = esp_tls_conn_new_sync(url, strlen(url), atoi(port), &cfg, s_tls);
+	PROFILE_END(PROFILE_CONNECT);
+	if (n != 1){
+		ESP_LOGE(TAG, "TLS handshake with %s failed", url);
+		https_close();
+		return HTTPS_ERROR;
+	}
+	duration = (uint32_t)(esp_timer_get_time() - start);
+
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+	if (https_resumed(cfg.client_session != NULL, duration)){
+		s_stats.resumed++;
+	}
+	else{
+		s_fullHandshakeUs = duration;
+	}
+	s_saveSession = true;
+#endif
+	s_stats.handshakes++;
+	s_stats.lastHandshakeUs = duration;
+	s_stats.totalHandshakeUs += duration;
+	if (duration > s_stats.maxHandshakeUs){
+		s_stats.maxHandshakeUs = duration;
+	}
+	ESP_LOGI(TAG, "Handshake %u took %u ms (%u of %u offered sessions resumed, %u requests so far)",
+		(unsigned int)s_stats.handshakes, (unsigned int)(duration / 1000), (unsigned int)s_stats.resumed,
+		(unsigned int)s_stats.resumeAttempts, (unsigned int)s_stats.requests);
+
+	return 0;
+}
+
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+/**
+ * @brief Judges from its duration whether the handshake just done resumed the offered
+ * session. mbedtls has no public way to tell (TLS 1.2 session IDs are random with
+ * tickets, TLS 1.3 resumes over a PSK), but a resumption skips the certificate chain,
+ * its verification and the key exchange round trip, so it takes well under half the
+ * time of a full handshake to the same server.
+ * 
+ * @param offered a saved session was offered
+ * @param durationUs 
+ * @return true 
+ * @return false 
+ */
+static bool https_resumed(bool offered, uint32_t durationUs)
+{
+	return offered && s_fullHandshakeUs > 0 && durationUs < s_fullHandshakeUs / 2;
+}
+
+/**
+ * @brief Keeps the session of a fresh connection for the next reconnect. Done after the
+ * first response rather than the handshake, TLS 1.3 servers send their ticket after it.
+ * 
+ */
+static void https_save_session(void)
+{
+	if (!s_saveSession || s_tls == NULL){
+		return;
+	}
+	s_saveSession = false;
+
+	if (s_session != NULL){
+		esp_tls_free_client_session(s_session);
+	}
+	s_session = esp_tls_get_client_session(s_tls);
+}
+#endif
+
+/**
+ * @brief Checks a kept connection before reusing it. Between requests nothing should
+ * arrive, anything readable is the server closing it (close notify or FIN).
+ * 
+ * @return true replace the connection
+ * @return false 
+ */
+static bool https_stale(void)
+{
+	struct timeval tv = { 0 };
+	fd_set readable;
+	int fd;
+
+	if (esp_tls_get_conn_sockfd(s_tls, &fd) != ESP_OK){
+		return true;
+	}
+
+	FD_ZERO(&readable);
+	FD_SET(fd, &readable);
+	return select(fd + 1, &readable, NULL, NULL, &tv) != 0;
+}
+
+/**
+ * @brief Refills the response buffer, consumed bytes are dropped
+ * 
+ * @return int bytes read or HTTPS_ERROR (0 on a clean close)
+ */
+static int https_fill(void)
+{
+	ssize_t n;
+
+	n = esp_tls_conn_read(s_tls, s_rxBuff, RXBUFF_SIZE - 1);
+	if (n < 0){
+		return HTTPS_ERROR;
+	}
+	s_rxPos = 0;
+	s_rxLen = n;
+	return n;
+}
+
+/**
+ * @brief Reads one CRLF terminated line, anything past size - 1 characters is dropped
+ * 
+ * @param line 
+ * @param size 
+ * @return int line length or HTTPS_ERROR
+ */
+static int https_read_line(char *line, size_t size)
+{
+	size_t n = 0;
+	char c;
+
+	for (;;)
+	{
+		if (s_rxPos == s_rxLen && https_fill() <= 0){
+			return HTTPS_ERROR;
+		}
+		c = s_rxBuff[s_rxPos++];
+		if (c == '\n'){
+			break;
+		}
+		if (n < size - 1){
+			line[n++] = c;
+		}
+	}
+
+	if (n > 0 && line[n - 1] == '\r'){
+		n--;
+	}
+	line[n] = '\0';
+	return n;
+}
+
+/**
+ * @brief Discards count body bytes, or everything until the connection ends when count is negative
+ * 
+ * @param count 
+ * @return int 0 or HTTPS_ERROR
+ */
+static int https_skip(long count)
+{
+	size_t take;
+	int n;
+
+	while (count != 0)
+	{
+		if (s_rxPos == s_rxLen){
+			n = https_fill();
+			if (n <= 0 && count < 0){
+				// The response was complete, the request must not be sent again
+				return 0;
+			}
+			if (n <= 0){
+				return HTTPS_ERROR;
+			}
+		}
+		take = s_rxLen - s_rxPos;
+		if (count > 0 && take > count){
+			take = count;
+		}
+		s_rxPos += take;
+		if (count > 0){
+			count -= take;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Discards a chunked body, trailers included
+ * 
+ * @return int 0 or HTTPS_ERROR
+ */
+static int https_skip_chunked(void)
+{
+	char line[64];
+	long size;
+
+	for (;;)
+	{
+		if (https_read_line(line, sizeof(line)) == HTTPS_ERROR){
+			return HTTPS_ERROR;
+		}
+		// Chunk extensions after ';' are ignored by strtol
+		size = strtol(line, NULL, 16);
+		if (size < 0){
+			return HTTPS_ERROR;
+		}
+		if (size == 0){
+			break;
+		}
+		if (https_skip(size) == HTTPS_ERROR || https_read_line(line, sizeof(line)) == HTTPS_ERROR){
+			return HTTPS_ERROR;
+		}
+	}
+
+	// Trailers end at an empty line
+	do {
+		if (https_read_line(line, sizeof(line)) == HTTPS_ERROR){
+			return HTTPS_ERROR;
+		}
+	} while (line[0] != '\0');
+
+	return 0;
+}
+
+/**
+ * @brief Reads the status line and headers then skips the body (Content-Length,
+ * chunked or until close) so the connection is ready for the next request
+ * 
+ * @return int status code or HTTPS_ERROR
+ */
+static int https_read_response(void)
+{
+	size_t len = 0;
+	int n;
+	char *end = NULL;
+	const char *hdr;
+	int status;
+	long remaining = -1;			// Body length, -1 until the server closes
+	bool chunked = false;
+	bool closeAfter = false;
+
+	// Headers
+	while (end == NULL)
+	{
+		if (len >= RXBUFF_SIZE - 1){
+			ESP_LOGE(TAG, "Response headers too long");
+			return HTTPS_ERROR;
+		}
+		n = esp_tls_conn_read(s_tls, &s_rxBuff[len], RXBUFF_SIZE - 1 - len);
+		if (n <= 0){
+			return HTTPS_ERROR;
+		}
+		len += n;
+		s_rxBuff[len] = '\0';
+		end = strstr(s_rxBuff, "\r\n\r\n");
+	}
+
+	if (sscanf(s_rxBuff, "HTTP/1.%*d %d", &status) != 1){
+		ESP_LOGE(TAG, "Malformed status line");
+		return HTTPS_ERROR;
+	}
+
+	http_apply_rate_hints(s_rxBuff, end);
+	http_apply_params(s_rxBuff, end);
+
+	// chunked is always the last coding listed
+	if ((hdr = http_find_header(s_rxBuff, end, "Transfer-Encoding:")) != NULL){
+		n = strcspn(hdr, "\r\n");
+		chunked = n >= 7 && strncasecmp(&hdr[n - 7], "chunked", 7) == 0;
+	}
+	if (chunked){
+		// Length comes with each chunk
+	} else if ((hdr = http_find_header(s_rxBuff, end, "Content-Length:")) != NULL){
+		remaining = strtol(hdr, NULL, 10);
+	} else if (status / 100 == 1 || status == 204 || status == 304){
+		remaining = 0;
+	}
+	if ((hdr = http_find_header(s_rxBuff, end, "Connection:")) != NULL && strncasecmp(hdr, " close", 6) == 0){
+		closeAfter = true;
+	}
+
+	// Body, part of it may already be in the buffer
+	s_rxPos = end + 4 - s_rxBuff;
+	s_rxLen = len;
+	if (chunked){
+		n = https_skip_chunked();
+	} else {
+		n = https_skip(remaining);
+	}
+	if (n == HTTPS_ERROR){
+		return HTTPS_ERROR;
+	}
+
+	// A body that ran to the close leaves nothing to reuse
+	if (closeAfter || (!chunked && remaining < 0)){
+		https_close();
+	}
+
+	return status;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file https.h
+ * @author Flynn Harrison
+ * @brief HTTPS requests over a kept alive TLS connection. The TLS session is saved
+ * after every handshake and offered again on reconnect so a full handshake is only
+ * needed when the server forgets the session.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef HTTPS_H
+#define HTTPS_H
+
+#include <stdint.h>
+
+#define HTTPS_ERROR -1
+
+typedef struct {
+	uint32_t handshakes;			// Handshakes performed (full or resumed)
+	uint32_t resumeAttempts;		// Handshakes that offered a saved session
+	uint32_t resumed;				// Of those, handshakes under half as long as the last full one (resumed)
+	uint32_t requests;				// Requests sent
+	uint32_t lastHandshakeUs;
+	uint32_t maxHandshakeUs;
+	uint64_t totalHandshakeUs;
+} https_stats_t;
+
+/**
+ * @brief Sends a POST request to path, reusing the open connection if there is one
+ * 
+ * @param url server address
+ * @param port server port
+ * @param path request path and query string
+ * @return int HTTP status code, 0 if the request was sent but no response came back
+ * (not sent again, the server may have stored it), or HTTPS_ERROR if it was not sent
+ */
+int https_send_request(const char* url, const char* port, const char* path);
+
+/**
+ * @brief Closes the connection. The saved session is kept for the next handshake
+ * 
+ */
+void https_close(void);
+
+/**
+ * @brief Copy of the handshake counters
+ * 
+ * @param stats 
+ */
+void https_get_stats(https_stats_t *stats);
+
+#endif
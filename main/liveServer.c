@@ -0,0 +1,127 @@
+/**
+ * @file liveServer.c
+ * @author Flynn Harrison
+ * @brief Local HTTP endpoint serving the live beacon table
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "liveServer.h"
+
+#include <stdio.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+#include "sdkconfig.h"
+
+#include "liveTable.h"
+
+#define LIVE_SERVER_PORT    CONFIG_LIVE_TABLE_PORT
+#define JSON_BUFF_SIZE      128
+
+static const char TAG[] = "Live server";
+
+static httpd_handle_t s_server = NULL;
+
+// Handlers run one at a time in the server task, so these can be shared
+static liveTable_entry_t s_snapshot[LIVE_TABLE_SIZE];
+static uint8_t s_packed[LIVE_TABLE_PACKED_LEN(LIVE_TABLE_SIZE)];
+
+static esp_err_t send_busy(httpd_req_t *req)
+{
+	// Only happens while the scan is updating the table nonstop, try again shortly
+	httpd_resp_set_status(req, "503 Service Unavailable");
+	httpd_resp_set_hdr(req, "Retry-After", "1");
+	return httpd_resp_send(req, NULL, 0);
+}
+
+static esp_err_t beacons_json_handler(httpd_req_t *req)
+{
+	char buff[JSON_BUFF_SIZE];
+	int64_t now = esp_timer_get_time();
+	int count;
+
+	count = live_table_snapshot(s_snapshot, now);
+	if (count == LIVE_TABLE_ERROR){
+		return send_busy(req);
+	}
+
+	// Chunked, one beacon at a time, so the table size does not set the stack size
+	httpd_resp_set_type(req, "application/json");
+	snprintf(buff, sizeof(buff), "{\"deviceID\":%d,\"uptimeMs\":%u,\"beacons\":[",
+		live_table_device_id(), (unsigned int)(now / 1000));
+	httpd_resp_sendstr_chunk(req, buff);
+
+	for (int i = 0; i < count; i++){
+		if (i > 0){
+			httpd_resp_sendstr_chunk(req, ",");
+		}
+		live_table_format_json(buff, sizeof(buff), &s_snapshot[i], now);
+		httpd_resp_sendstr_chunk(req, buff);
+	}
+
+	httpd_resp_sendstr_chunk(req, "]}");
+	return httpd_resp_sendstr_chunk(req, NULL);
+}
+
+static esp_err_t beacons_bin_handler(httpd_req_t *req)
+{
+	int64_t now = esp_timer_get_time();
+	int count;
+	int n;
+
+	count = live_table_snapshot(s_snapshot, now);
+	if (count == LIVE_TABLE_ERROR){
+		return send_busy(req);
+	}
+
+	n = live_table_pack(s_packed, sizeof(s_packed), s_snapshot, count, now);
+	if (n == LIVE_TABLE_ERROR){
+		return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, NULL);
+	}
+
+	httpd_resp_set_type(req, "application/octet-stream");
+	return httpd_resp_send(req, (const char *)s_packed, n);
+}
+
+esp_err_t live_server_start(void)
+{
+	httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+	esp_err_t ret;
+
+	const httpd_uri_t jsonUri = {
+		.uri = "/beacons",
+		.method = HTTP_GET,
+		.handler = beacons_json_handler,
+	};
+	const httpd_uri_t binUri = {
+		.uri = "/beacons.bin",
+		.method = HTTP_GET,
+		.handler = beacons_bin_handler,
+	};
+
+	if (s_server != NULL){
+		return ESP_OK;
+	}
+
+	// Below the scan and upload tasks, a slow client must not delay either
+	config.server_port = LIVE_SERVER_PORT;
+	config.task_priority = 1;
+	config.lru_purge_enable = true;
+
+	ret = httpd_start(&s_server, &config);
+	if (ret != ESP_OK){
+		ESP_LOGE(TAG, "Failed to start server: %s", esp_err_to_name(ret));
+		s_server = NULL;
+		return ret;
+	}
+
+	httpd_register_uri_handler(s_server, &jsonUri);
+	httpd_register_uri_handler(s_server, &binUri);
+	ESP_LOGI(TAG, "Serving the live beacon table on port %d", LIVE_SERVER_PORT);
+	return ESP_OK;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file liveServer.h
+ * @author Flynn Harrison
+ * @brief Local HTTP endpoint serving the live beacon table (see liveTable.h)
+ * GET /beacons for JSON, GET /beacons.bin for the compact binary snapshot.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef LIVESERVER_H
+#define LIVESERVER_H
+
+#include "esp_err.h"
+
+/**
+ * @brief Starts the server, does nothing if it is already running. Call once the
+ * network stack is up.
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t live_server_start(void);
+
+#endif
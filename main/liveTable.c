@@ -0,0 +1,165 @@
+/**
+ * @file liveTable.c
+ * @author Flynn Harrison
+ * @brief Table of the beacons this receiver currently hears
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "liveTable.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#define LIVE_TABLE_EXPIRE_US    (CONFIG_LIVE_TABLE_EXPIRE_S * 1000000LL)
+#define LIVE_TABLE_MAX_RETRIES  8		// Snapshot attempts before giving up
+
+static const char TAG[] = "Live table";
+
+// Written only by the GAP callback, odd s_seq while an update is in progress.
+// Readers (HTTP server task, possibly on the other core) copy the table and retry
+// if s_seq moved, so the scan path never waits on a reader.
+static liveTable_entry_t s_table[LIVE_TABLE_SIZE];
+static uint32_t s_seq;
+static uint32_t s_retries;
+static int8_t s_deviceID = -1;
+
+static void put_u32(uint8_t *buf, uint32_t val)
+{
+	buf[0] = val & 0xFF;
+	buf[1] = (val >> 8) & 0xFF;
+	buf[2] = (val >> 16) & 0xFF;
+	buf[3] = (val >> 24) & 0xFF;
+}
+
+static uint32_t age_ms(const liveTable_entry_t *entry, int64_t nowUs)
+{
+	return nowUs > entry->lastSeenUs ? (uint32_t)((nowUs - entry->lastSeenUs) / 1000) : 0;
+}
+
+void live_table_update(const ble_beacon_recived_t *rd, int64_t nowUs)
+{
+	liveTable_entry_t *entry = NULL;
+	liveTable_entry_t *oldest = &s_table[0];
+	uint32_t seq = s_seq;
+
+	for (int i = 0; i < LIVE_TABLE_SIZE; i++)
+	{
+		if (s_table[i].lastSeenUs != 0 && memcmp(s_table[i].uuid_32b, rd->uuid_32b, ADV_DATA_SERVICE_LEN) == 0)
+		{
+			entry = &s_table[i];
+			break;
+		}
+		if (s_table[i].lastSeenUs < oldest->lastSeenUs)
+		{
+			oldest = &s_table[i];
+		}
+	}
+
+	__atomic_store_n(&s_seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	if (entry == NULL)
+	{
+		// Empty slots have lastSeenUs 0 so they go first
+		entry = oldest;
+		memcpy(entry->uuid_32b, rd->uuid_32b, ADV_DATA_SERVICE_LEN);
+		entry->count = 0;
+	}
+	s_deviceID = rd->deviceID;
+	entry->format = rd->format;
+	entry->rssi = rd->rssi;
+	entry->TxPower = rd->TxPower;
+	entry->count++;
+	entry->lastSeenUs = nowUs;
+
+	__atomic_store_n(&s_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+int live_table_snapshot(liveTable_entry_t *entries, int64_t nowUs)
+{
+	uint32_t before;
+	uint32_t after;
+	int count = 0;
+
+	for (int attempt = 0; attempt < LIVE_TABLE_MAX_RETRIES; attempt++)
+	{
+		before = __atomic_load_n(&s_seq, __ATOMIC_ACQUIRE);
+		if ((before & 1) == 0)
+		{
+			memcpy(entries, s_table, sizeof(s_table));
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			after = __atomic_load_n(&s_seq, __ATOMIC_RELAXED);
+			if (before == after)
+			{
+				// Drop empty and expired slots
+				for (int i = 0; i < LIVE_TABLE_SIZE; i++)
+				{
+					if (entries[i].lastSeenUs != 0 && nowUs - entries[i].lastSeenUs < LIVE_TABLE_EXPIRE_US)
+					{
+						entries[count++] = entries[i];
+					}
+				}
+				return count;
+			}
+		}
+		__atomic_fetch_add(&s_retries, 1, __ATOMIC_RELAXED);
+	}
+
+	ESP_LOGW(TAG, "No consistent snapshot after %d attempts", LIVE_TABLE_MAX_RETRIES);
+	return LIVE_TABLE_ERROR;
+}
+
+int live_table_format_json(char *buf, size_t len, const liveTable_entry_t *entry, int64_t nowUs)
+{
+	return snprintf(buf, len, "{\"id\":\"%02x%02x%02x%02x\",\"format\":\"%s\",\"rssi\":%d,\"txPower\":%u,\"ageMs\":%u,\"count\":%u}",
+		entry->uuid_32b[0], entry->uuid_32b[1], entry->uuid_32b[2], entry->uuid_32b[3],
+		ble_beacon_format_name(entry->format), entry->rssi, entry->TxPower,
+		(unsigned int)age_ms(entry, nowUs), (unsigned int)entry->count);
+}
+
+int live_table_pack(uint8_t *buf, size_t len, const liveTable_entry_t *entries, int count, int64_t nowUs)
+{
+	uint8_t *out;
+
+	if (count < 0 || count > UINT8_MAX || len < LIVE_TABLE_PACKED_LEN(count))
+	{
+		return LIVE_TABLE_ERROR;
+	}
+
+	buf[0] = LIVE_TABLE_MAGIC_0;
+	buf[1] = LIVE_TABLE_MAGIC_1;
+	buf[2] = LIVE_TABLE_VERSION;
+	buf[3] = (uint8_t)s_deviceID;
+	buf[4] = (uint8_t)count;
+	put_u32(&buf[5], (uint32_t)(nowUs / 1000));
+
+	out = &buf[LIVE_TABLE_HEADER_LEN];
+	for (int i = 0; i < count; i++)
+	{
+		memcpy(out, entries[i].uuid_32b, ADV_DATA_SERVICE_LEN);
+		out[4] = entries[i].format;
+		out[5] = (uint8_t)entries[i].rssi;
+		out[6] = entries[i].TxPower;
+		put_u32(&out[7], age_ms(&entries[i], nowUs));
+		put_u32(&out[11], entries[i].count);
+		out += LIVE_TABLE_ENTRY_LEN;
+	}
+
+	return LIVE_TABLE_PACKED_LEN(count);
+}
+
+int8_t live_table_device_id(void)
+{
+	return s_deviceID;
+}
+
+uint32_t live_table_retries(void)
+{
+	return __atomic_load_n(&s_retries, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,102 @@
+/**
+ * @file liveTable.h
+ * @author Flynn Harrison
+ * @brief Table of the beacons this receiver currently hears, for local consumers.
+ * The GAP callback updates it, readers take consistent snapshots through a seqlock
+ * so they never hold up the scan.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef LIVETABLE_H
+#define LIVETABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "beaconBLE.h"
+#include "sdkconfig.h"
+
+#define LIVE_TABLE_ERROR -1
+
+#define LIVE_TABLE_SIZE     CONFIG_LIVE_TABLE_SIZE
+
+// Binary snapshot (little endian)
+// [0..1] 'F','L', [2] version, [3] deviceID, [4] entry count, [5..8] uptime ms, then per entry:
+// [0..3] uuid_32b, [4] format, [5] rssi, [6] TxPower, [7..10] ms since last heard, [11..14] count
+#define LIVE_TABLE_MAGIC_0      'F'
+#define LIVE_TABLE_MAGIC_1      'L'
+#define LIVE_TABLE_VERSION      1
+#define LIVE_TABLE_HEADER_LEN   9
+#define LIVE_TABLE_ENTRY_LEN    15
+#define LIVE_TABLE_PACKED_LEN(n)    (LIVE_TABLE_HEADER_LEN + (n) * LIVE_TABLE_ENTRY_LEN)
+
+typedef struct {
+	uint8_t uuid_32b[ADV_DATA_SERVICE_LEN];
+	uint8_t format;				// ble_beacon_format_t
+	int8_t rssi;				// Last heard
+	uint8_t TxPower;
+	uint32_t count;				// Scan results since the beacon entered the table
+	int64_t lastSeenUs;			// esp_timer_get_time() when last heard
+} liveTable_entry_t;
+
+/**
+ * @brief Records a scan result (GAP callback only, the table has a single writer).
+ * A new beacon takes the slot of the one heard longest ago when the table is full.
+ * 
+ * @param rd reading with rssi filled in
+ * @param nowUs esp_timer_get_time()
+ */
+void live_table_update(const ble_beacon_recived_t *rd, int64_t nowUs);
+
+/**
+ * @brief Copies out the beacons heard within the expiry window. Never blocks the
+ * writer, the copy is retried if the writer changed the table meanwhile.
+ * 
+ * @param entries LIVE_TABLE_SIZE entries
+ * @param nowUs esp_timer_get_time()
+ * @return int entries copied or LIVE_TABLE_ERROR if no consistent copy could be taken
+ */
+int live_table_snapshot(liveTable_entry_t *entries, int64_t nowUs);
+
+/**
+ * @brief Formats one entry as a JSON object
+ * 
+ * @param buf
+ * @param len
+ * @param entry
+ * @param nowUs same time as the snapshot
+ * @return int snprintf result
+ */
+int live_table_format_json(char *buf, size_t len, const liveTable_entry_t *entry, int64_t nowUs);
+
+/**
+ * @brief Packs a snapshot in the binary format above
+ * 
+ * @param buf
+ * @param len at least LIVE_TABLE_PACKED_LEN(count)
+ * @param entries
+ * @param count
+ * @param nowUs same time as the snapshot
+ * @return int bytes written or LIVE_TABLE_ERROR
+ */
+int live_table_pack(uint8_t *buf, size_t len, const liveTable_entry_t *entries, int count, int64_t nowUs);
+
+/**
+ * @brief Receiver ID, taken from the readings (-1 before the first one)
+ * 
+ * @return int8_t
+ */
+int8_t live_table_device_id(void);
+
+/**
+ * @brief Snapshots that had to be retried because the writer was active, since boot
+ * 
+ * @return uint32_t
+ */
+uint32_t live_table_retries(void);
+
+#endif
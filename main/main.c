@@ -15,22 +15,72 @@
 #include "esp_log.h"
 #include "nvs.h"
 #include "nvs_flash.h"
+#include "sdkconfig.h"
 
 #include "beaconApp.h"
 #include "beaconBLE.h"
 #include "WiFi.h"
 #include "databaseApp.h"
+#include "memReport.h"
+#include "trace.h"
 
 #include "globalQueues.h"
+#include "params.h"
 
-#define BEACON_QUEUE_LEN 10
-QueueHandle_t beaconQueueHandle = NULL;	// evil global
+#if defined(CONFIG_BENCHMARK_ON_BOOT)
+#include "bench.h"
+#endif
+#if defined(CONFIG_ALLOWLIST_ENABLE)
+#include "allowlist.h"
+#endif
+#if defined(CONFIG_UPLOAD_TRANSPORT_UART)
+#include "uartSink.h"
+#endif
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+#include "rssiHist.h"
+#endif
+
+#define WIFI_TASK_STACK   CONFIG_WIFI_TASK_STACK_SIZE
+#define BLE_TASK_STACK    CONFIG_BLE_TASK_STACK_SIZE
+#define UPLOAD_TASK_STACK CONFIG_UPLOAD_TASK_STACK_SIZE
+
+// Per target task layout
+#if defined(CONFIG_FREERTOS_UNICORE)
+// Single core (C3), the BLE task scans then uploads
+#define SCAN_CORE   tskNO_AFFINITY
+#define UPLOAD_CORE tskNO_AFFINITY
+#else
+// Dual core (ESP32, S3), Bluedroid and the controller live on core 0 (see sdkconfig.defaults.<target>)
+// so scanning and decode stay there while WiFi, TLS and uploading own core 1
+#define SCAN_CORE   0
+#define UPLOAD_CORE 1
+#endif
+
+#if defined(CONFIG_STATIC_ALLOCATION)
+// Everything the tasks need, sized at link time
+#if !defined(CONFIG_UPLOAD_TRANSPORT_UART)
+static StackType_t wifiTaskStack[WIFI_TASK_STACK];
+static StaticTask_t wifiTaskBuffer;
+#endif
+static StackType_t bleTaskStack[BLE_TASK_STACK];
+static StaticTask_t bleTaskBuffer;
+#if !defined(CONFIG_FREERTOS_UNICORE)
+static StackType_t uploadTaskStack[UPLOAD_TASK_STACK];
+static StaticTask_t uploadTaskBuffer;
+#endif
+#define TASK_BUFFERS(task) task##Stack, &task##Buffer
+#else
+#define TASK_BUFFERS(task) NULL, NULL
+#endif
 
 static const char TAG[] = "Main";
 
+static TaskHandle_t createTask(TaskFunction_t fn, const char *name, uint32_t stackSize, UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb, BaseType_t core);
+
 void app_main(void)
 {
 	esp_err_t ret;
+	TaskHandle_t task;
 
 	// Init NVS
 	ret = nvs_flash_init();
@@ -42,28 +92,81 @@ void app_main(void)
 
 	ESP_LOGI(TAG, "Device ready");
 
+	// Before any task reads them
+	params_init();
+
+#if defined(CONFIG_ALLOWLIST_ENABLE)
+	// Before scanning starts, a failed load accepts every beacon
+	allowlist_init();
+#endif
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+	// First interval counts from boot like the samples in it
+	rssi_hist_init();
+#endif
+
+#if defined(CONFIG_BENCHMARK_ON_BOOT)
+	// Before any other task so nothing competes for the CPU
+	bench_target_run();
+#endif
+
 	// Create Queue for found beacons 
-	beaconQueueHandle = xQueueCreate(BEACON_QUEUE_LEN, sizeof(ble_beacon_recived_t));
-	if (beaconQueueHandle == NULL){
+	if (beaconHandoffInit() != ESP_OK){
 		ESP_LOGE(TAG, "Queue failed to be created");
 		return;
 	}
 
+#if defined(CONFIG_TRACE_ENABLE)
+	// Logging the trace stays off the scan core
+	if (trace_init(UPLOAD_CORE) != ESP_OK){
+		ESP_LOGE(TAG, "Trace task failed to be created");
+	}
+#endif
+
+#if defined(CONFIG_UPLOAD_TRANSPORT_UART)
+	// Wired to a gateway, WiFi is never started
+	if (uart_sink_init() != ESP_OK){
+		return;
+	}
+#else
 	// If WiFi enabled
-	xTaskCreate(
-		WiFiManageTask,
-		"WiFi manage",
-		8000,
-		NULL,
-		3,
-		NULL
-	);
-
-	xTaskCreate(
-		vBeaconRXTask,      // Task function
-		"BLE Beacon",       // Name
-		8000,           	// Stack size (bytes)
-		NULL,               // Parameters passed to the function
-		2,                  // Priority
-		NULL);              // Task handle
+	task = createTask(WiFiManageTask, "WiFi manage", WIFI_TASK_STACK, 3, TASK_BUFFERS(wifiTask), UPLOAD_CORE);
+	memReportRegisterTask(task, WIFI_TASK_STACK);
+#endif
+
+#if !defined(CONFIG_FREERTOS_UNICORE)
+	task = createTask(vDatabaseContact, "Upload", UPLOAD_TASK_STACK, 2, TASK_BUFFERS(uploadTask), UPLOAD_CORE);
+	memReportRegisterTask(task, UPLOAD_TASK_STACK);
+#endif
+
+	task = createTask(vBeaconRXTask, "BLE Beacon", BLE_TASK_STACK, 2, TASK_BUFFERS(bleTask), SCAN_CORE);
+	memReportRegisterTask(task, BLE_TASK_STACK);
 }
+
+/**
+ * @brief Creates a task, statically when CONFIG_STATIC_ALLOCATION is set
+ * 
+ * @param fn Task function
+ * @param name Name
+ * @param stackSize Stack size (bytes)
+ * @param priority Priority
+ * @param stack Stack, NULL when allocating dynamically
+ * @param tcb Task control block, NULL when allocating dynamically
+ * @param core Core to pin to or tskNO_AFFINITY
+ * @return TaskHandle_t 
+ */
+static TaskHandle_t createTask(TaskFunction_t fn, const char *name, uint32_t stackSize, UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb, BaseType_t core)
+{
+	TaskHandle_t handle = NULL;
+
+#if defined(CONFIG_STATIC_ALLOCATION)
+	handle = xTaskCreateStaticPinnedToCore(fn, name, stackSize, NULL, priority, stack, tcb, core);
+#else
+	xTaskCreatePinnedToCore(fn, name, stackSize, NULL, priority, &handle, core);
+#endif
+	if (handle == NULL){
+		ESP_LOGE(TAG, "Failed to create task %s", name);
+	}
+
+	return handle;
+}
\ No newline at end of file
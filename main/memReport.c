@@ -0,0 +1,55 @@
+/**
+ * @file memReport.c
+ * @author Flynn Harrison
+ * @brief Stack high water and heap low water reporting
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "memReport.h"
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+
+typedef struct {
+	TaskHandle_t handle;
+	uint32_t stackSize;
+} memReport_task_t;
+
+static const char TAG[] = "Memory";
+
+static memReport_task_t s_tasks[MEMREPORT_MAX_TASKS];
+static int s_taskCount = 0;
+
+void memReportRegisterTask(TaskHandle_t handle, uint32_t stackSize)
+{
+	if (handle == NULL || s_taskCount >= MEMREPORT_MAX_TASKS)
+	{
+		return;
+	}
+
+	s_tasks[s_taskCount].handle = handle;
+	s_tasks[s_taskCount].stackSize = stackSize;
+	s_taskCount++;
+}
+
+void memReportLog(void)
+{
+	UBaseType_t unused;
+
+	// On ESP-IDF the high water mark is in bytes
+	for (int i = 0; i < s_taskCount; i++)
+	{
+		unused = uxTaskGetStackHighWaterMark(s_tasks[i].handle);
+		ESP_LOGI(TAG, "%-12s stack used %u of %u bytes (%u never touched)", pcTaskGetTaskName(s_tasks[i].handle),
+			(unsigned int)(s_tasks[i].stackSize - unused), (unsigned int)s_tasks[i].stackSize, (unsigned int)unused);
+	}
+
+	ESP_LOGI(TAG, "Heap free %u bytes, low water %u bytes, largest block %u bytes",
+		(unsigned int)esp_get_free_heap_size(), (unsigned int)esp_get_minimum_free_heap_size(),
+		(unsigned int)heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+}
@@ -0,0 +1,37 @@
+/**
+ * @file memReport.h
+ * @author Flynn Harrison
+ * @brief Stack high water and heap low water reporting, used to right size the
+ * Kconfig stack and buffer sizes
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef MEMREPORT_H
+#define MEMREPORT_H
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define MEMREPORT_MAX_TASKS 8
+
+/**
+ * @brief Adds a task to the report
+ * 
+ * @param handle 
+ * @param stackSize stack the task was created with (bytes)
+ */
+void memReportRegisterTask(TaskHandle_t handle, uint32_t stackSize);
+
+/**
+ * @brief Logs unused stack of every registered task and the heap low water mark
+ * 
+ */
+void memReportLog(void);
+
+#endif
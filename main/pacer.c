@@ -0,0 +1,135 @@
+/**
+ * @file pacer.c
+ * @author Flynn Harrison
+ * @brief Upload pacing shared by every transport
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "pacer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include "profile.h"
+
+#define PACER_RATE          CONFIG_UPLOAD_RATE_PER_S		// Tokens added per second
+#define PACER_BURST         CONFIG_UPLOAD_BURST				// Bucket size
+#define PACER_JITTER_MS     CONFIG_UPLOAD_JITTER_MS
+#define PACER_MAX_HOLD_MS   (CONFIG_UPLOAD_MAX_HOLD_OFF_S * 1000)		// Cap on what a server may ask for
+
+#define TOKEN 1000			// Tokens are kept in thousandths
+
+static const char TAG[] = "Pacer";
+
+// Tokens are only taken by the upload path, which runs in a single task
+static int64_t s_tokens = PACER_BURST * TOKEN;
+static int64_t s_lastRefillUs;
+static int64_t s_holdUntilUs;
+static pacer_stats_t s_stats;
+
+static void pacer_refill(int64_t now)
+{
+	if (s_lastRefillUs != 0)
+	{
+		s_tokens += (now - s_lastRefillUs) * PACER_RATE * TOKEN / 1000000;
+		if (s_tokens > PACER_BURST * TOKEN)
+		{
+			s_tokens = PACER_BURST * TOKEN;
+		}
+	}
+	s_lastRefillUs = now;
+}
+
+void pacer_wait(void)
+{
+	int64_t waitUs;
+
+	pacer_refill(esp_timer_get_time());
+	if (s_tokens < TOKEN)
+	{
+		// Time until the bucket holds a whole token
+		waitUs = (TOKEN - s_tokens) * 1000000 / (PACER_RATE * TOKEN);
+		s_stats.waits++;
+		s_stats.waitedMs += (uint32_t)(waitUs / 1000);
+		PROFILE_BEGIN(PROFILE_SLEEP);
+		vTaskDelay(pdMS_TO_TICKS(waitUs / 1000) + 1);
+		PROFILE_END(PROFILE_SLEEP);
+		pacer_refill(esp_timer_get_time());
+	}
+
+	s_tokens -= TOKEN;
+	s_stats.requests++;
+}
+
+void pacer_hold_off(uint32_t ms)
+{
+	int64_t until;
+
+	if (ms > PACER_MAX_HOLD_MS)
+	{
+		ms = PACER_MAX_HOLD_MS;
+	}
+	// Spread the fleet's return over the jitter window as well
+	ms += esp_random() % (PACER_JITTER_MS + 1);
+
+	until = esp_timer_get_time() + (int64_t)ms * 1000;
+	if (until > s_holdUntilUs)
+	{
+		s_holdUntilUs = until;
+	}
+
+	s_stats.holdOffs++;
+	s_stats.lastHoldOffMs = ms;
+	ESP_LOGW(TAG, "Server asked to hold off, pausing uploads for %u ms", (unsigned int)ms);
+}
+
+bool pacer_holding(void)
+{
+	return esp_timer_get_time() < s_holdUntilUs;
+}
+
+uint32_t pacer_hold_remaining_ms(void)
+{
+	int64_t remaining = s_holdUntilUs - esp_timer_get_time();
+
+	return remaining > 0 ? (uint32_t)(remaining / 1000) : 0;
+}
+
+void pacer_jitter(void)
+{
+	if (PACER_JITTER_MS > 0)
+	{
+		vTaskDelay(pdMS_TO_TICKS(esp_random() % (PACER_JITTER_MS + 1)));
+	}
+}
+
+uint32_t pacer_phase_ms(uint32_t periodMs)
+{
+	uint8_t mac[6];
+	uint32_t seed = esp_random();
+
+	// esp_random() may not be truly random this early (RF is off), the MAC makes sure
+	// receivers that booted together still differ
+	if (esp_efuse_mac_get_default(mac) == ESP_OK)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			seed = (seed ^ mac[i]) * 16777619u;
+		}
+	}
+
+	return periodMs > 0 ? seed % periodMs : 0;
+}
+
+void pacer_get_stats(pacer_stats_t *stats)
+{
+	*stats = s_stats;
+}
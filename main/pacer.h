@@ -0,0 +1,81 @@
+/**
+ * @file pacer.h
+ * @author Flynn Harrison
+ * @brief Upload pacing shared by every transport. A token bucket caps requests per
+ * second and server hints (Retry-After, RateLimit-Reset, UDP ack hold off) pause
+ * uploads altogether, readings wait in the beacon backlog meanwhile.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+	uint32_t requests;			// Tokens taken
+	uint32_t waits;				// Requests that had to wait for a token
+	uint32_t waitedMs;			// Total time spent waiting for tokens
+	uint32_t holdOffs;			// Server hints received
+	uint32_t lastHoldOffMs;
+} pacer_stats_t;
+
+/**
+ * @brief Takes a token, waiting for one if the bucket is empty. Call before each
+ * request or datagram (upload path only).
+ * 
+ */
+void pacer_wait(void);
+
+/**
+ * @brief Pauses uploads for ms, as asked by the server. A shorter hint does not
+ * cut an earlier longer one short.
+ * 
+ * @param ms 
+ */
+void pacer_hold_off(uint32_t ms);
+
+/**
+ * @brief True while a server hold off is in force
+ * 
+ * @return true 
+ * @return false 
+ */
+bool pacer_holding(void);
+
+/**
+ * @brief Time left of the hold off
+ * 
+ * @return uint32_t ms, 0 when not holding off
+ */
+uint32_t pacer_hold_remaining_ms(void);
+
+/**
+ * @brief Random delay of up to UPLOAD_JITTER_MS, so receivers woken together do
+ * not upload together
+ * 
+ */
+void pacer_jitter(void);
+
+/**
+ * @brief Random offset within period that differs between receivers, for the
+ * phase of the scan cycle at boot
+ * 
+ * @param periodMs 
+ * @return uint32_t 
+ */
+uint32_t pacer_phase_ms(uint32_t periodMs);
+
+/**
+ * @brief Counters since boot
+ * 
+ * @param stats 
+ */
+void pacer_get_stats(pacer_stats_t *stats);
+
+#endif
@@ -0,0 +1,374 @@
+/**
+ * @file params.c
+ * @author Flynn Harrison
+ * @brief Pipeline parameters stored in NVS
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "params.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+#include "beaconBLE.h"
+
+#define PARAMS_NVS_NAMESPACE    "params"
+
+// Built in defaults, used until a valid value is in NVS
+#define DEFAULT_CYCLE_MS        (1000*8)
+#define DEFAULT_RX_MS           (1000*2)
+#define DEFAULT_DEVICE_ID       1
+#define DEFAULT_SERVER          "159.196.72.33"
+
+typedef enum {
+	PARAM_TYPE_INT,
+	PARAM_TYPE_STR,
+} param_type_t;
+
+typedef struct {
+	const char *name;			// NVS key, at most 15 characters
+	param_type_t type;
+	int32_t min;				// Bounds, string length for PARAM_TYPE_STR
+	int32_t max;
+	int32_t defInt;
+	const char *defStr;
+} param_def_t;
+
+typedef struct {
+	int32_t i;
+	char s[PARAM_STR_MAX + 1];
+} param_value_t;
+
+static const param_def_t s_defs[PARAM_COUNT] = {
+	[PARAM_SCAN_INTERVAL] = { "scan_interval", PARAM_TYPE_INT, 0x0004, 0x4000, SCN_PARAM_SCAN_INTERVAL, NULL },
+	[PARAM_SCAN_WINDOW]   = { "scan_window",   PARAM_TYPE_INT, 0x0004, 0x4000, SCN_PARAM_SCAN_WINDOW, NULL },
+	[PARAM_CYCLE_MS]      = { "cycle_ms",      PARAM_TYPE_INT, 1000, 3600000, DEFAULT_CYCLE_MS, NULL },
+	[PARAM_RX_MS]         = { "rx_ms",         PARAM_TYPE_INT, 100, 60000, DEFAULT_RX_MS, NULL },
+	[PARAM_QUEUE_LEN]     = { "queue_len",     PARAM_TYPE_INT, 1, CONFIG_BEACON_QUEUE_LEN, CONFIG_BEACON_QUEUE_LEN, NULL },
+	[PARAM_DEVICE_ID]     = { "device_id",     PARAM_TYPE_INT, 0, 127, DEFAULT_DEVICE_ID, NULL },
+	[PARAM_SERVER]        = { "server",        PARAM_TYPE_STR, 1, PARAM_STR_MAX, 0, DEFAULT_SERVER },
+};
+
+static const char TAG[] = "Params";
+
+// Read by every task, staged by the uploader, applied by the scan task
+static param_value_t s_values[PARAM_COUNT];
+static param_value_t s_staged[PARAM_COUNT];
+static uint32_t s_stagedMask;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void params_set_default(param_id_t id, param_value_t *value)
+{
+	value->i = s_defs[id].defInt;
+	value->s[0] = '\0';
+	if (s_defs[id].type == PARAM_TYPE_STR)
+	{
+		strlcpy(value->s, s_defs[id].defStr, sizeof(value->s));
+	}
+}
+
+/**
+ * @brief Bounds check on its own, see params_consistent() for rules between parameters
+ * 
+ * @param id
+ * @param value
+ * @return true
+ * @return false
+ */
+static bool params_valid(param_id_t id, const param_value_t *value)
+{
+	size_t len;
+
+	if (s_defs[id].type == PARAM_TYPE_INT)
+	{
+		return value->i >= s_defs[id].min && value->i <= s_defs[id].max;
+	}
+
+	len = strnlen(value->s, sizeof(value->s));
+	if (len < s_defs[id].min || len > s_defs[id].max)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < len; i++)
+	{
+		if (value->s[i] <= ' ' || value->s[i] > '~' || value->s[i] == ',')
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool params_consistent(const param_value_t *values)
+{
+	return values[PARAM_SCAN_WINDOW].i <= values[PARAM_SCAN_INTERVAL].i &&
+		values[PARAM_RX_MS].i < values[PARAM_CYCLE_MS].i;
+}
+
+static bool params_equal(param_id_t id, const param_value_t *a, const param_value_t *b)
+{
+	return s_defs[id].type == PARAM_TYPE_INT ? a->i == b->i : strcmp(a->s, b->s) == 0;
+}
+
+static void params_log(param_id_t id, const param_value_t *value)
+{
+	if (s_defs[id].type == PARAM_TYPE_INT)
+	{
+		ESP_LOGI(TAG, "%-14s %d", s_defs[id].name, (int)value->i);
+	}
+	else
+	{
+		ESP_LOGI(TAG, "%-14s %s", s_defs[id].name, value->s);
+	}
+}
+
+esp_err_t params_init(void)
+{
+	param_value_t values[PARAM_COUNT];
+	nvs_handle_t handle;
+	size_t len;
+	esp_err_t ret;
+
+	for (int id = 0; id < PARAM_COUNT; id++)
+	{
+		params_set_default(id, &values[id]);
+	}
+
+	ret = nvs_open(PARAMS_NVS_NAMESPACE, NVS_READONLY, &handle);
+	if (ret == ESP_OK)
+	{
+		for (int id = 0; id < PARAM_COUNT; id++)
+		{
+			if (s_defs[id].type == PARAM_TYPE_INT)
+			{
+				ret = nvs_get_i32(handle, s_defs[id].name, &values[id].i);
+			}
+			else
+			{
+				len = sizeof(values[id].s);
+				ret = nvs_get_str(handle, s_defs[id].name, values[id].s, &len);
+			}
+
+			if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND)
+			{
+				ESP_LOGW(TAG, "Failed to read %s: %s", s_defs[id].name, esp_err_to_name(ret));
+			}
+			if (ret != ESP_OK || !params_valid(id, &values[id]))
+			{
+				params_set_default(id, &values[id]);
+			}
+		}
+		nvs_close(handle);
+	}
+	else if (ret != ESP_ERR_NVS_NOT_FOUND)
+	{
+		ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(ret));
+	}
+
+	if (!params_consistent(values))
+	{
+		ESP_LOGE(TAG, "Stored parameters are inconsistent, using the defaults");
+		for (int id = 0; id < PARAM_COUNT; id++)
+		{
+			params_set_default(id, &values[id]);
+		}
+	}
+
+	taskENTER_CRITICAL(&s_lock);
+	memcpy(s_values, values, sizeof(s_values));
+	taskEXIT_CRITICAL(&s_lock);
+
+	for (int id = 0; id < PARAM_COUNT; id++)
+	{
+		params_log(id, &values[id]);
+	}
+
+	return ESP_OK;
+}
+
+int32_t params_get(param_id_t id)
+{
+	int32_t value;
+
+	taskENTER_CRITICAL(&s_lock);
+	value = s_values[id].i;
+	taskEXIT_CRITICAL(&s_lock);
+
+	return value;
+}
+
+void params_get_str(param_id_t id, char *buf, size_t len)
+{
+	taskENTER_CRITICAL(&s_lock);
+	strlcpy(buf, s_values[id].s, len);
+	taskEXIT_CRITICAL(&s_lock);
+}
+
+const char *params_name(param_id_t id)
+{
+	return s_defs[id].name;
+}
+
+int params_push(const char *text)
+{
+#if defined(CONFIG_PARAMS_REMOTE_PUSH)
+	param_value_t value;
+	const char *next;
+	const char *end;
+	const char *eq;
+	size_t nameLen;
+	size_t valueLen;
+	char *parsed;
+	int staged = 0;
+	int id;
+
+	while (*text != '\0' && *text != '\r' && *text != '\n')
+	{
+		text += strspn(text, " ,");
+		next = text + strcspn(text, ",\r\n");
+		for (end = next; end > text && end[-1] == ' '; end--);
+		eq = memchr(text, '=', end - text);
+		if (eq == NULL)
+		{
+			text = next;
+			continue;
+		}
+
+		nameLen = eq - text;
+		for (id = 0; id < PARAM_COUNT; id++)
+		{
+			if (strlen(s_defs[id].name) == nameLen && strncmp(s_defs[id].name, text, nameLen) == 0)
+			{
+				break;
+			}
+		}
+
+		valueLen = end - (eq + 1);
+		if (id == PARAM_COUNT)
+		{
+			ESP_LOGW(TAG, "Ignoring unknown parameter %.*s", (int)nameLen, text);
+		}
+		else
+		{
+			memset(&value, 0, sizeof(value));
+			if (s_defs[id].type == PARAM_TYPE_INT)
+			{
+				// Whole value must be a number
+				value.i = strtol(eq + 1, &parsed, 0);
+				valueLen = parsed != end ? 0 : valueLen;
+			}
+			else if (valueLen <= PARAM_STR_MAX)
+			{
+				memcpy(value.s, eq + 1, valueLen);
+			}
+			else
+			{
+				valueLen = 0;
+			}
+
+			if (valueLen == 0 || !params_valid(id, &value))
+			{
+				ESP_LOGW(TAG, "Ignoring out of bounds %s=%.*s", s_defs[id].name, (int)(end - eq - 1), eq + 1);
+			}
+			else
+			{
+				taskENTER_CRITICAL(&s_lock);
+				if (!params_equal(id, &value, &s_values[id]))
+				{
+					s_staged[id] = value;
+					s_stagedMask |= PARAM_BIT(id);
+					staged++;
+				}
+				taskEXIT_CRITICAL(&s_lock);
+			}
+		}
+
+		text = next;
+	}
+
+	return staged;
+#else
+	ESP_LOGD(TAG, "Remote parameters disabled, ignoring a push");
+	return 0;
+#endif
+}
+
+uint32_t params_apply(void)
+{
+	param_value_t values[PARAM_COUNT];
+	uint32_t changed = 0;
+	nvs_handle_t handle;
+	esp_err_t ret;
+
+	taskENTER_CRITICAL(&s_lock);
+	memcpy(values, s_values, sizeof(values));
+	for (int id = 0; id < PARAM_COUNT; id++)
+	{
+		if ((s_stagedMask & PARAM_BIT(id)) && !params_equal(id, &s_staged[id], &values[id]))
+		{
+			values[id] = s_staged[id];
+			changed |= PARAM_BIT(id);
+		}
+	}
+	s_stagedMask = 0;
+	if (changed != 0 && params_consistent(values))
+	{
+		memcpy(s_values, values, sizeof(s_values));
+	}
+	taskEXIT_CRITICAL(&s_lock);
+
+	if (changed == 0)
+	{
+		return 0;
+	}
+	if (!params_consistent(values))
+	{
+		ESP_LOGE(TAG, "Pushed parameters rejected, scan window must not exceed the interval and the receive time must be shorter than the cycle");
+		return 0;
+	}
+
+	for (int id = 0; id < PARAM_COUNT; id++)
+	{
+		if (changed & PARAM_BIT(id))
+		{
+			params_log(id, &values[id]);
+		}
+	}
+
+	// Saved so they survive a reboot, the new values are in use either way
+	ret = nvs_open(PARAMS_NVS_NAMESPACE, NVS_READWRITE, &handle);
+	if (ret == ESP_OK)
+	{
+		for (int id = 0; id < PARAM_COUNT && ret == ESP_OK; id++)
+		{
+			if (changed & PARAM_BIT(id))
+			{
+				ret = s_defs[id].type == PARAM_TYPE_INT ? nvs_set_i32(handle, s_defs[id].name, values[id].i) :
+					nvs_set_str(handle, s_defs[id].name, values[id].s);
+			}
+		}
+		if (ret == ESP_OK)
+		{
+			ret = nvs_commit(handle);
+		}
+		nvs_close(handle);
+	}
+	if (ret != ESP_OK)
+	{
+		ESP_LOGE(TAG, "Failed to store parameters: %s", esp_err_to_name(ret));
+	}
+
+	return changed;
+}
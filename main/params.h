@@ -0,0 +1,92 @@
+/**
+ * @file params.h
+ * @author Flynn Harrison
+ * @brief Pipeline parameters that can be tuned without a reflash. Read from NVS at
+ * boot, the collector can push new values in an upload response, those are
+ * validated, saved and take effect at the start of the next scan cycle.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#define PARAM_ERROR -1
+
+#define PARAM_STR_MAX       48		// Longest string value, excluding the terminator
+
+typedef enum {
+	PARAM_SCAN_INTERVAL = 0,		// BLE scan interval, N * 0.625 ms
+	PARAM_SCAN_WINDOW,				// BLE scan window, N * 0.625 ms, at most the interval
+	PARAM_CYCLE_MS,					// Time between scan starts
+	PARAM_RX_MS,					// Longest scan, shorter than the cycle
+	PARAM_QUEUE_LEN,				// Backlog slots in use, at most BEACON_QUEUE_LEN
+	PARAM_DEVICE_ID,				// Receiver ID sent with every reading
+	PARAM_SERVER,					// Collector address (string)
+	PARAM_COUNT
+} param_id_t;
+
+#define PARAM_BIT(id)       (1UL << (id))
+#define PARAM_ALL           (PARAM_BIT(PARAM_COUNT) - 1)
+
+/**
+ * @brief Loads every parameter from NVS (namespace "params", key = parameter name).
+ * Missing or out of bounds values fall back to the built in defaults.
+ * 
+ * @return esp_err_t
+ */
+esp_err_t params_init(void);
+
+/**
+ * @brief Current value of an integer parameter
+ * 
+ * @param id
+ * @return int32_t
+ */
+int32_t params_get(param_id_t id);
+
+/**
+ * @brief Copies the current value of a string parameter
+ * 
+ * @param id
+ * @param buf
+ * @param len at least PARAM_STR_MAX + 1
+ */
+void params_get_str(param_id_t id, char *buf, size_t len);
+
+/**
+ * @brief Name used in NVS and in pushes
+ * 
+ * @param id
+ * @return const char*
+ */
+const char *params_name(param_id_t id);
+
+/**
+ * @brief Stages values pushed by the collector, "name=value" pairs separated by
+ * commas, ending at the end of the string or a CR/LF. Each value is bounds checked,
+ * unknown names and bad values are logged and skipped.
+ * 
+ * @param text
+ * @return int values staged that differ from the current ones
+ */
+int params_push(const char *text);
+
+/**
+ * @brief Applies the staged values (scan task, at the start of a cycle) and saves
+ * them to NVS. A set that breaks a rule between parameters (window > interval,
+ * receive time >= cycle) is dropped as a whole.
+ * 
+ * @return uint32_t PARAM_BIT() of every parameter that changed
+ */
+uint32_t params_apply(void);
+
+#endif
@@ -0,0 +1,258 @@
+/**
+ * @file presence.c
+ * @author Flynn Harrison
+ * @brief Per beacon presence tracking
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "presence.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#define PRESENCE_TABLE_SIZE         CONFIG_PRESENCE_TABLE_SIZE
+#define PRESENCE_ENTER_RSSI         CONFIG_PRESENCE_ENTER_RSSI
+#define PRESENCE_ENTER_SIGHTINGS    CONFIG_PRESENCE_ENTER_SIGHTINGS
+#define PRESENCE_EXIT_RSSI          CONFIG_PRESENCE_EXIT_RSSI
+#define PRESENCE_EXIT_TIMEOUT_US    (CONFIG_PRESENCE_EXIT_TIMEOUT_S * 1000000LL)
+#define PRESENCE_HEARTBEAT_US       (CONFIG_PRESENCE_HEARTBEAT_S * 1000000LL)
+#define PRESENCE_SMOOTHING          CONFIG_PRESENCE_RSSI_SMOOTHING	// New sample weighted 1 / 2^n
+
+#define RSSI_SCALE 16		// Smoothed RSSI is kept in 1/16 dBm
+
+#if PRESENCE_EXIT_RSSI > PRESENCE_ENTER_RSSI
+#error "PRESENCE_EXIT_RSSI must not be above PRESENCE_ENTER_RSSI"
+#endif
+
+typedef struct {
+	ble_beacon_recived_t last;	// Last sighting, reported with every event
+	int64_t lastSeenUs;
+	int64_t lastReportUs;
+	int16_t rssi;				// Smoothed, RSSI_SCALE
+	uint8_t sightings;			// Since the smoothed RSSI was seeded, saturates
+	uint8_t used;
+	uint8_t present;
+} presence_entry_t;
+
+static const char TAG[] = "Presence";
+
+// Only touched from databaseContact(), which runs in a single task. Other tasks read
+// the counters through s_snapshot, refreshed after every call.
+static presence_entry_t s_table[PRESENCE_TABLE_SIZE];
+static presence_stats_t s_stats;
+static presence_stats_t s_snapshot;
+static portMUX_TYPE s_snapshotLock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Emits an event, the caller has already moved the entry to its new state.
+ * When it is not delivered the state goes back so the event comes up again.
+ * 
+ * @return int 1 or PRESENCE_ERROR
+ */
+static int presence_emit(presence_entry_t *entry, ble_beacon_event_t event, int64_t nowUs, presence_emit_t emit)
+{
+	ble_beacon_recived_t rd = entry->last;
+
+	rd.event = event;
+	rd.rssi = (int8_t)(entry->rssi / RSSI_SCALE);
+	if (!emit(&rd))
+	{
+		s_stats.undelivered++;
+		if (event == BLE_BEACON_EVENT_ENTER)
+		{
+			entry->present = 0;
+		}
+		else if (event == BLE_BEACON_EVENT_EXIT)
+		{
+			entry->present = 1;
+		}
+		return PRESENCE_ERROR;
+	}
+	entry->lastReportUs = nowUs;
+
+	switch (event)
+	{
+	case BLE_BEACON_EVENT_ENTER:
+		s_stats.enters++;
+		break;
+	case BLE_BEACON_EVENT_EXIT:
+		s_stats.exits++;
+		break;
+	case BLE_BEACON_EVENT_HEARTBEAT:
+		s_stats.heartbeats++;
+		break;
+	default:
+		break;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Publishes the counters for presence_get_stats()
+ * 
+ */
+static void presence_publish(void)
+{
+	presence_stats_t stats = s_stats;
+
+	stats.tracked = 0;
+	stats.present = 0;
+	for (int i = 0; i < PRESENCE_TABLE_SIZE; i++)
+	{
+		stats.tracked += s_table[i].used;
+		stats.present += s_table[i].present;
+	}
+
+	taskENTER_CRITICAL(&s_snapshotLock);
+	s_snapshot = stats;
+	taskEXIT_CRITICAL(&s_snapshotLock);
+}
+
+static presence_entry_t *presence_find(uint32_t key)
+{
+	for (int i = 0; i < PRESENCE_TABLE_SIZE; i++)
+	{
+		if (s_table[i].used && ble_beacon_key(&s_table[i].last) == key)
+		{
+			return &s_table[i];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Finds a free slot, otherwise evicts the beacon heard longest ago (absent
+ * beacons first). An evicted present beacon gets its EXIT so consumers stay in step.
+ * 
+ */
+static presence_entry_t *presence_alloc(int64_t nowUs, presence_emit_t emit, int *events)
+{
+	presence_entry_t *oldest = NULL;
+
+	for (int i = 0; i < PRESENCE_TABLE_SIZE; i++)
+	{
+		if (!s_table[i].used)
+		{
+			return &s_table[i];
+		}
+		if (oldest == NULL || s_table[i].present < oldest->present ||
+			(s_table[i].present == oldest->present && s_table[i].lastSeenUs < oldest->lastSeenUs))
+		{
+			oldest = &s_table[i];
+		}
+	}
+
+	s_stats.evictions++;
+	if (oldest->present)
+	{
+		// Not retried, the slot is about to hold another beacon
+		ESP_LOGW(TAG, "Table full, evicting present beacon %08x", (unsigned int)ble_beacon_key(&oldest->last));
+		*events = presence_emit(oldest, BLE_BEACON_EVENT_EXIT, nowUs, emit);
+	}
+
+	return oldest;
+}
+
+int presence_observe(const ble_beacon_recived_t *rd, int64_t nowUs, presence_emit_t emit)
+{
+	presence_entry_t *entry;
+	int events = 0;
+	int n = 0;
+
+	s_stats.sightings++;
+
+	entry = presence_find(ble_beacon_key(rd));
+	if (entry == NULL)
+	{
+		entry = presence_alloc(nowUs, emit, &events);
+		memset(entry, 0, sizeof(*entry));
+		entry->used = 1;
+		entry->rssi = rd->rssi * RSSI_SCALE;
+	}
+	else if (nowUs - entry->lastSeenUs >= PRESENCE_EXIT_TIMEOUT_US)
+	{
+		// Back after timing out, old history says nothing about where it is now
+		entry->rssi = rd->rssi * RSSI_SCALE;
+		entry->sightings = 0;
+	}
+	else
+	{
+		entry->rssi += (rd->rssi * RSSI_SCALE - entry->rssi) / (1 << PRESENCE_SMOOTHING);
+	}
+	if (entry->sightings < UINT8_MAX)
+	{
+		entry->sightings++;
+	}
+
+	entry->last = *rd;
+	entry->lastSeenUs = nowUs;
+
+	// Thresholds are apart so a beacon sitting on the boundary does not flap, and the
+	// smoothed RSSI has to be built from a few sightings before it can enter
+	if (!entry->present && entry->sightings >= PRESENCE_ENTER_SIGHTINGS && entry->rssi >= PRESENCE_ENTER_RSSI * RSSI_SCALE)
+	{
+		entry->present = 1;
+		n = presence_emit(entry, BLE_BEACON_EVENT_ENTER, nowUs, emit);
+	}
+	else if (entry->present && entry->rssi < PRESENCE_EXIT_RSSI * RSSI_SCALE)
+	{
+		entry->present = 0;
+		n = presence_emit(entry, BLE_BEACON_EVENT_EXIT, nowUs, emit);
+	}
+	else if (entry->present && nowUs - entry->lastReportUs >= PRESENCE_HEARTBEAT_US)
+	{
+		n = presence_emit(entry, BLE_BEACON_EVENT_HEARTBEAT, nowUs, emit);
+	}
+
+	presence_publish();
+	return n == PRESENCE_ERROR || events == PRESENCE_ERROR ? PRESENCE_ERROR : events + n;
+}
+
+int presence_sweep(int64_t nowUs, presence_emit_t emit)
+{
+	int events = 0;
+
+	for (int i = 0; i < PRESENCE_TABLE_SIZE; i++)
+	{
+		if (!s_table[i].used || nowUs - s_table[i].lastSeenUs < PRESENCE_EXIT_TIMEOUT_US)
+		{
+			continue;
+		}
+
+		if (s_table[i].present)
+		{
+			s_table[i].present = 0;
+			if (presence_emit(&s_table[i], BLE_BEACON_EVENT_EXIT, nowUs, emit) == PRESENCE_ERROR)
+			{
+				events = PRESENCE_ERROR;
+				break;
+			}
+			events++;
+		}
+		else if (nowUs - s_table[i].lastReportUs >= PRESENCE_EXIT_TIMEOUT_US)
+		{
+			// Absent for a whole timeout since the last event, free the slot
+			s_table[i].used = 0;
+		}
+	}
+
+	presence_publish();
+	return events;
+}
+
+void presence_get_stats(presence_stats_t *stats)
+{
+	taskENTER_CRITICAL(&s_snapshotLock);
+	*stats = s_snapshot;
+	taskEXIT_CRITICAL(&s_snapshotLock);
+}
@@ -0,0 +1,73 @@
+/**
+ * @file presence.h
+ * @author Flynn Harrison
+ * @brief Per beacon presence tracking. Raw sightings go in, only ENTER, EXIT and
+ * periodic HEARTBEAT events come out.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "beaconBLE.h"
+
+#define PRESENCE_ERROR -1
+
+/**
+ * @brief Called for every event. rd is the last sighting of the beacon with event set
+ * and rssi replaced by the smoothed value. Returns false when the event was not
+ * delivered, it is emitted again on a later call.
+ * 
+ */
+typedef bool (*presence_emit_t)(const ble_beacon_recived_t *rd);
+
+typedef struct {
+	uint32_t sightings;			// Readings fed in
+	uint32_t enters;
+	uint32_t exits;
+	uint32_t heartbeats;
+	uint32_t evictions;			// Beacons dropped because the table was full
+	uint32_t undelivered;		// Events emit failed on, retried later
+	uint32_t tracked;			// Beacons in the table right now
+	uint32_t present;			// Of those, how many are inside the zone
+} presence_stats_t;
+
+/**
+ * @brief Feeds a sighting into the beacon's state machine. Emits ENTER once the
+ * beacon has been heard PRESENCE_ENTER_SIGHTINGS times and the smoothed RSSI reaches
+ * the enter threshold, EXIT once it falls below the exit
+ * threshold and HEARTBEAT while the beacon stays present.
+ * 
+ * @param rd sighting
+ * @param nowUs when the beacon was heard, esp_timer_get_time() time base
+ * @param emit
+ * @return int number of events emitted, or PRESENCE_ERROR once emit fails
+ */
+int presence_observe(const ble_beacon_recived_t *rd, int64_t nowUs, presence_emit_t emit);
+
+/**
+ * @brief Emits EXIT for present beacons that have not been heard within the exit
+ * timeout and forgets beacons that have been absent for as long. Call once a cycle,
+ * after the cycle's sightings have been observed.
+ * 
+ * @param nowUs esp_timer_get_time()
+ * @param emit
+ * @return int number of events emitted, or PRESENCE_ERROR once emit fails
+ */
+int presence_sweep(int64_t nowUs, presence_emit_t emit);
+
+/**
+ * @brief Counters since boot, as of the last observe or sweep (any task)
+ * 
+ * @param stats
+ */
+void presence_get_stats(presence_stats_t *stats);
+
+#endif
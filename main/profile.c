@@ -0,0 +1,238 @@
+/**
+ * @file profile.c
+ * @author Flynn Harrison
+ * @brief Per cycle timeline profiler for the scan/upload loop
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "profile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define PROFILE_HISTORY         CONFIG_PROFILE_HISTORY_CYCLES	// Cycles the percentiles cover
+#define PROFILE_REPORT_CYCLES   CONFIG_PROFILE_REPORT_CYCLES
+#if defined(CONFIG_PROFILE_CHROME_TRACE)
+#define PROFILE_EVENTS          CONFIG_PROFILE_TIMELINE_EVENTS	// Spans kept for the Chrome trace
+#endif
+
+// Markers around the trace so tools/profile_extract.py can find it in a serial log
+#define PROFILE_TRACE_BEGIN     "--- chrome trace begin ---"
+#define PROFILE_TRACE_END       "--- chrome trace end ---"
+
+typedef struct {
+	int64_t startUs;
+	uint32_t durationUs;
+	uint8_t span;
+	uint8_t core;
+} profile_event_t;
+
+static const char TAG[] = "Profile";
+
+static const char *const s_spanNames[PROFILE_SPAN_COUNT] = {
+	[PROFILE_CYCLE] = "cycle",
+	[PROFILE_WIFI_WAIT] = "wifi_wait",
+	[PROFILE_SCAN_START] = "scan_start",
+	[PROFILE_SCAN] = "scan",
+	[PROFILE_UPLOAD] = "upload",
+	[PROFILE_DNS] = "dns",
+	[PROFILE_CONNECT] = "connect",
+	[PROFILE_WRITE] = "write",
+	[PROFILE_READ] = "read",
+	[PROFILE_SLEEP] = "sleep",
+};
+
+// Spans open and close in the scan task, the Bluedroid task and (on dual core) the
+// upload task, everything below is only touched under the lock
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int64_t s_open[PROFILE_SPAN_COUNT];				// Start of each open span, 0 when closed
+static uint32_t s_cycleUs[PROFILE_SPAN_COUNT];			// Time in each span this cycle or upload round
+static uint32_t s_cycleCalls[PROFILE_SPAN_COUNT];
+static uint32_t s_historyUs[PROFILE_SPAN_COUNT][PROFILE_HISTORY];
+static uint32_t s_historyCalls[PROFILE_SPAN_COUNT];		// Since boot
+static uint32_t s_cycles;
+static uint32_t s_uploads;								// Upload rounds, the upload spans' history index
+
+#if defined(CONFIG_PROFILE_CHROME_TRACE)
+static profile_event_t s_events[PROFILE_EVENTS];
+static uint32_t s_eventCount;							// Total written, index is modulo PROFILE_EVENTS
+#endif
+
+static void profile_report(void);
+#if defined(CONFIG_PROFILE_CHROME_TRACE)
+static void profile_dump_trace(void);
+#endif
+
+void profile_begin(profile_span_t span)
+{
+	int64_t now = esp_timer_get_time();
+
+	taskENTER_CRITICAL(&s_lock);
+	s_open[span] = now;
+	taskEXIT_CRITICAL(&s_lock);
+}
+
+void profile_end(profile_span_t span)
+{
+	int64_t now = esp_timer_get_time();
+	int64_t start;
+#if defined(CONFIG_PROFILE_CHROME_TRACE)
+	profile_event_t *event;
+#endif
+
+	taskENTER_CRITICAL(&s_lock);
+	start = s_open[span];
+	if (start == 0)
+	{
+		taskEXIT_CRITICAL(&s_lock);
+		return;
+	}
+	s_open[span] = 0;
+
+	s_cycleUs[span] += (uint32_t)(now - start);
+	s_cycleCalls[span]++;
+
+#if defined(CONFIG_PROFILE_CHROME_TRACE)
+	event = &s_events[s_eventCount++ % PROFILE_EVENTS];
+	event->startUs = start;
+	event->durationUs = (uint32_t)(now - start);
+	event->span = span;
+	event->core = xPortGetCoreID();
+#endif
+	taskEXIT_CRITICAL(&s_lock);
+}
+
+/**
+ * @brief Moves the sums of spans [first, last) into history slot (lock held)
+ * 
+ */
+static void profile_close(int first, int last, uint32_t slot)
+{
+	for (int span = first; span < last; span++)
+	{
+		s_historyUs[span][slot] = s_cycleUs[span];
+		s_historyCalls[span] += s_cycleCalls[span];
+		s_cycleUs[span] = 0;
+		s_cycleCalls[span] = 0;
+	}
+}
+
+void profile_cycle_end(void)
+{
+	uint32_t cycles;
+
+	taskENTER_CRITICAL(&s_lock);
+	profile_close(0, PROFILE_UPLOAD, s_cycles % PROFILE_HISTORY);
+	cycles = ++s_cycles;
+	taskEXIT_CRITICAL(&s_lock);
+
+	if (PROFILE_REPORT_CYCLES > 0 && cycles % PROFILE_REPORT_CYCLES == 0)
+	{
+		profile_report();
+#if defined(CONFIG_PROFILE_CHROME_TRACE)
+		profile_dump_trace();
+#endif
+	}
+}
+
+void profile_upload_end(void)
+{
+	taskENTER_CRITICAL(&s_lock);
+	profile_close(PROFILE_UPLOAD, PROFILE_SPAN_COUNT, s_uploads % PROFILE_HISTORY);
+	s_uploads++;
+	taskEXIT_CRITICAL(&s_lock);
+}
+
+const char *profile_span_name(profile_span_t span)
+{
+	return span < PROFILE_SPAN_COUNT ? s_spanNames[span] : "unknown";
+}
+
+/**
+ * @brief Logs p50, p90 and max time per cycle (upload round for the upload spans) for
+ * every span over the history
+ * 
+ */
+static void profile_report(void)
+{
+	uint32_t sorted[PROFILE_HISTORY];
+	uint32_t rounds;
+	uint32_t calls;
+	uint32_t n;
+	uint32_t value;
+	int j;
+
+	ESP_LOGI(TAG, "Time per scan cycle, and per upload round from %s on", s_spanNames[PROFILE_UPLOAD]);
+	for (int span = 0; span < PROFILE_SPAN_COUNT; span++)
+	{
+		// Copied out under the lock, sorted outside it
+		taskENTER_CRITICAL(&s_lock);
+		rounds = span < PROFILE_UPLOAD ? s_cycles : s_uploads;
+		n = rounds < PROFILE_HISTORY ? rounds : PROFILE_HISTORY;
+		memcpy(sorted, s_historyUs[span], n * sizeof(sorted[0]));
+		calls = s_historyCalls[span];
+		taskEXIT_CRITICAL(&s_lock);
+
+		if (n == 0)
+		{
+			continue;
+		}
+
+		// Insertion sort, the history is small and this runs once a report
+		for (uint32_t i = 1; i < n; i++)
+		{
+			value = sorted[i];
+			for (j = i; j > 0 && sorted[j - 1] > value; j--)
+			{
+				sorted[j] = sorted[j - 1];
+			}
+			sorted[j] = value;
+		}
+
+		ESP_LOGI(TAG, "%-10s p50 %7u us  p90 %7u us  max %7u us  %u calls/round over %u", s_spanNames[span],
+			(unsigned int)sorted[n / 2], (unsigned int)sorted[n * 9 / 10], (unsigned int)sorted[n - 1],
+			(unsigned int)(calls / rounds), (unsigned int)n);
+	}
+}
+
+#if defined(CONFIG_PROFILE_CHROME_TRACE)
+/**
+ * @brief Prints the last PROFILE_EVENTS spans as a Chrome trace (JSON object format,
+ * complete events) between markers. tid is the core the span ended on.
+ * 
+ */
+static void profile_dump_trace(void)
+{
+	profile_event_t event;
+	uint32_t first;
+	uint32_t last;
+
+	taskENTER_CRITICAL(&s_lock);
+	last = s_eventCount;
+	taskEXIT_CRITICAL(&s_lock);
+	first = last > PROFILE_EVENTS ? last - PROFILE_EVENTS : 0;
+
+	printf("%s\n{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", PROFILE_TRACE_BEGIN);
+	for (uint32_t i = first; i < last; i++)
+	{
+		// One at a time so the lock is never held while printing
+		taskENTER_CRITICAL(&s_lock);
+		event = s_events[i % PROFILE_EVENTS];
+		taskEXIT_CRITICAL(&s_lock);
+
+		printf("{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%u,\"pid\":0,\"tid\":%u}%s\n", s_spanNames[event.span],
+			(long long)event.startUs, (unsigned int)event.durationUs, (unsigned int)event.core, i + 1 < last ? "," : "");
+	}
+	printf("]}\n%s\n", PROFILE_TRACE_END);
+}
+#endif
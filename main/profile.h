@@ -0,0 +1,89 @@
+/**
+ * @file profile.h
+ * @author Flynn Harrison
+ * @brief Per cycle timeline profiler for the scan/upload loop. Spans are timed with
+ * esp_timer, summed per scan cycle and reported as percentiles over recent cycles,
+ * optionally with the raw timeline as a Chrome trace (chrome://tracing, Perfetto).
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+// Timed phases, a span may run several times a cycle (one DNS lookup per request).
+// Spans before PROFILE_UPLOAD belong to the scan cycle, the rest to the upload round,
+// which on dual core targets runs in its own task alongside the next scan.
+typedef enum {
+	PROFILE_CYCLE = 0,			// Whole scan cycle, excluding the wait for the next one
+	PROFILE_WIFI_WAIT,			// WiFiWaitUntillConnected()
+	PROFILE_SCAN_START,			// esp_ble_gap_start_scanning() until SCAN_START_COMPLETE
+	PROFILE_SCAN,				// Scan window
+	PROFILE_UPLOAD,				// databaseContact(), first of the upload round's spans
+	PROFILE_DNS,
+	PROFILE_CONNECT,			// TCP connect or TLS handshake
+	PROFILE_WRITE,
+	PROFILE_READ,				// Response or acknowledgements
+	PROFILE_SLEEP,				// Delays between and after requests
+	PROFILE_SPAN_COUNT
+} profile_span_t;
+
+#if defined(CONFIG_PROFILE_ENABLE)
+#define PROFILE_BEGIN(span) profile_begin(span)
+#define PROFILE_END(span) profile_end(span)
+#define PROFILE_CYCLE_END() profile_cycle_end()
+#define PROFILE_UPLOAD_END() profile_upload_end()
+#else
+#define PROFILE_BEGIN(span) do {} while (0)
+#define PROFILE_END(span) do {} while (0)
+#define PROFILE_CYCLE_END() do {} while (0)
+#define PROFILE_UPLOAD_END() do {} while (0)
+#endif
+
+/**
+ * @brief Opens a span. Begin and end may be in different functions (or tasks), but
+ * a span can only be open once at a time.
+ * 
+ * @param span 
+ */
+void profile_begin(profile_span_t span);
+
+/**
+ * @brief Closes a span, adding its duration to the current cycle and the timeline.
+ * Ignored if the span is not open.
+ * 
+ * @param span 
+ */
+void profile_end(profile_span_t span);
+
+/**
+ * @brief Closes the current cycle, called by the scan task at the end of each cycle.
+ * Every PROFILE_REPORT_CYCLES cycles the percentiles are logged (and the timeline
+ * dumped).
+ * 
+ */
+void profile_cycle_end(void);
+
+/**
+ * @brief Closes the current upload round, called by the uploader at the end of each
+ * databaseContact() that uploaded
+ * 
+ */
+void profile_upload_end(void);
+
+/**
+ * @brief Name of a span, used in the report and trace
+ * 
+ * @param span 
+ * @return const char* 
+ */
+const char *profile_span_name(profile_span_t span);
+
+#endif
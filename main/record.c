@@ -0,0 +1,236 @@
+/**
+ * @file record.c
+ * @author Flynn Harrison
+ * @brief Wire format for readings sent to the collector
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "record.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define HTTP_DATABASE			"rssi_submit"
+#define HTTP_VAR_PACKET_GROUP   "pkGroup"
+#define HTTP_VAR_UUID           "uuid"
+#define HTTP_VAR_RSSI           "rssi"
+#define HTTP_VAR_TX_POWER       "txPower"
+#define HTTP_VAR_DEVICEID		"deviceID"
+#define HTTP_VAR_FORMAT         "format"
+#define HTTP_VAR_ID             "id"
+#define HTTP_VAR_EVENT          "event"
+
+#define HTTP_HISTOGRAM          "rssi_hist"
+#define HTTP_VAR_LOW            "low"
+#define HTTP_VAR_WIDTH          "width"
+#define HTTP_VAR_MIN            "min"
+#define HTTP_VAR_MAX            "max"
+#define HTTP_VAR_BINS           "bins"
+
+#define HTTP_FINGERPRINT        "rssi_fingerprint"
+#define HTTP_VAR_SLOTS          "slots"
+#define HTTP_VAR_ORDER          "order"
+#define HTTP_VAR_HEARD          "heard"
+
+int record_pack_sighting(uint8_t *buf, size_t len, const ble_beacon_recived_t *rd)
+{
+	if (len < RECORD_SIGHTING_LEN)
+	{
+		return RECORD_ERROR;
+	}
+
+	buf[0] = RECORD_TYPE_SIGHTING;
+	buf[1] = rd->uuid_32b[0];
+	buf[2] = rd->uuid_32b[1];
+	buf[3] = rd->uuid_32b[2];
+	buf[4] = rd->uuid_32b[3];
+	buf[5] = (uint8_t)rd->rssi;
+	buf[6] = rd->TxPower;
+	buf[7] = (uint8_t)(rd->packetGroup & 0xFF);
+	buf[8] = (uint8_t)((rd->packetGroup >> 8) & 0xFF);
+	buf[9] = rd->format;
+
+	return RECORD_SIGHTING_LEN;
+}
+
+int record_pack_presence(uint8_t *buf, size_t len, const ble_beacon_recived_t *rd)
+{
+	if (len < RECORD_PRESENCE_LEN)
+	{
+		return RECORD_ERROR;
+	}
+
+	// Same layout as a sighting with the event appended
+	record_pack_sighting(buf, len, rd);
+	buf[0] = RECORD_TYPE_PRESENCE;
+	buf[10] = rd->event;
+
+	return RECORD_PRESENCE_LEN;
+}
+
+int record_pack_reading(uint8_t *buf, size_t len, const ble_beacon_recived_t *rd)
+{
+	if (rd->event == BLE_BEACON_EVENT_SIGHTING)
+	{
+		return record_pack_sighting(buf, len, rd);
+	}
+
+	return record_pack_presence(buf, len, rd);
+}
+
+int record_query_sighting(char *buf, size_t len, const ble_beacon_recived_t *rd)
+{
+	int n;
+
+	// Non ideal code, for testing we only care about the last number of the UUID
+	n = snprintf(buf, len, "%s?%s=%d&%s=%d&%s=%d&%s=%d", HTTP_DATABASE, HTTP_VAR_PACKET_GROUP, rd->packetGroup, HTTP_VAR_UUID, rd->uuid_32b[3], HTTP_VAR_RSSI, rd->rssi, HTTP_VAR_DEVICEID, rd->deviceID);
+	if (n < 0 || n >= len)
+	{
+		return RECORD_ERROR;
+	}
+
+	// Foreign formats carry their 32b key (hash of the full ID), our own tags keep the original request
+	if (rd->format != BLE_BEACON_FORMAT_FH)
+	{
+		n += snprintf(&buf[n], len - n, "&%s=%d&%s=%u", HTTP_VAR_FORMAT, rd->format, HTTP_VAR_ID, (unsigned int)ble_beacon_key(rd));
+		if (n >= len)
+		{
+			return RECORD_ERROR;
+		}
+	}
+
+	if (rd->event != BLE_BEACON_EVENT_SIGHTING)
+	{
+		n += snprintf(&buf[n], len - n, "&%s=%d", HTTP_VAR_EVENT, rd->event);
+		if (n >= len)
+		{
+			return RECORD_ERROR;
+		}
+	}
+
+	return n;
+}
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+int record_pack_histogram(uint8_t *buf, size_t len, const rssiHist_t *hist)
+{
+	if (len < RECORD_HISTOGRAM_LEN(RSSI_HIST_BINS))
+	{
+		return RECORD_ERROR;
+	}
+
+	buf[0] = RECORD_TYPE_HISTOGRAM;
+	buf[1] = hist->uuid_32b[0];
+	buf[2] = hist->uuid_32b[1];
+	buf[3] = hist->uuid_32b[2];
+	buf[4] = hist->uuid_32b[3];
+	buf[5] = hist->format;
+	buf[6] = (uint8_t)RSSI_HIST_LOW_DBM;
+	buf[7] = RSSI_HIST_BIN_DB;
+	buf[8] = RSSI_HIST_BINS;
+	buf[9] = (uint8_t)hist->minRssi;
+	buf[10] = (uint8_t)hist->maxRssi;
+	for (int i = 0; i < RSSI_HIST_BINS; i++)
+	{
+		buf[11 + 2 * i] = (uint8_t)(hist->bins[i] & 0xFF);
+		buf[12 + 2 * i] = (uint8_t)((hist->bins[i] >> 8) & 0xFF);
+	}
+
+	return RECORD_HISTOGRAM_LEN(RSSI_HIST_BINS);
+}
+
+int record_query_histogram(char *buf, size_t len, const rssiHist_t *hist)
+{
+	ble_beacon_recived_t rd = { 0 };
+	int n;
+
+	memcpy(rd.uuid_32b, hist->uuid_32b, ADV_DATA_SERVICE_LEN);
+	n = snprintf(buf, len, "%s?%s=%d&%s=%u&%s=%d&%s=%d&%s=%d&%s=%d&%s=%d&%s=", HTTP_HISTOGRAM, HTTP_VAR_DEVICEID, hist->deviceID,
+		HTTP_VAR_ID, (unsigned int)ble_beacon_key(&rd), HTTP_VAR_FORMAT, hist->format, HTTP_VAR_LOW, RSSI_HIST_LOW_DBM,
+		HTTP_VAR_WIDTH, RSSI_HIST_BIN_DB, HTTP_VAR_MIN, hist->minRssi, HTTP_VAR_MAX, hist->maxRssi, HTTP_VAR_BINS);
+	if (n < 0 || n >= len)
+	{
+		return RECORD_ERROR;
+	}
+
+	// Comma separated counts, lowest bin first
+	for (int i = 0; i < RSSI_HIST_BINS; i++)
+	{
+		n += snprintf(&buf[n], len - n, i == 0 ? "%u" : ",%u", hist->bins[i]);
+		if (n >= len)
+		{
+			return RECORD_ERROR;
+		}
+	}
+
+	return n;
+}
+#endif
+
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+int record_pack_fingerprint(uint8_t *buf, size_t len, const fingerprint_t *fp)
+{
+	size_t bitmapLen = (fp->slots + 7) / 8;
+
+	if (len < RECORD_FINGERPRINT_LEN(fp->slots))
+	{
+		return RECORD_ERROR;
+	}
+
+	buf[0] = RECORD_TYPE_FINGERPRINT;
+	buf[1] = (uint8_t)(fp->packetGroup & 0xFF);
+	buf[2] = (uint8_t)((fp->packetGroup >> 8) & 0xFF);
+	buf[3] = fp->slots;
+	buf[4] = (uint8_t)(fp->orderHash & 0xFF);
+	buf[5] = (uint8_t)((fp->orderHash >> 8) & 0xFF);
+	buf[6] = (uint8_t)((fp->orderHash >> 16) & 0xFF);
+	buf[7] = (uint8_t)((fp->orderHash >> 24) & 0xFF);
+	memcpy(&buf[8], fp->heard, bitmapLen);
+	memcpy(&buf[8 + bitmapLen], fp->rssi, fp->slots);
+
+	return RECORD_FINGERPRINT_LEN(fp->slots);
+}
+
+int record_query_fingerprint(char *buf, size_t len, const fingerprint_t *fp)
+{
+	int n;
+
+	n = snprintf(buf, len, "%s?%s=%d&%s=%d&%s=%u&%s=%u&%s=", HTTP_FINGERPRINT, HTTP_VAR_DEVICEID, fp->deviceID,
+		HTTP_VAR_PACKET_GROUP, fp->packetGroup, HTTP_VAR_SLOTS, fp->slots, HTTP_VAR_ORDER, (unsigned int)fp->orderHash,
+		HTTP_VAR_HEARD);
+	if (n < 0 || n >= len)
+	{
+		return RECORD_ERROR;
+	}
+
+	// Two hex digits per byte
+	for (int i = 0; i < (fp->slots + 7) / 8; i++)
+	{
+		n += snprintf(&buf[n], len - n, "%02x", fp->heard[i]);
+		if (n >= len)
+		{
+			return RECORD_ERROR;
+		}
+	}
+
+	n += snprintf(&buf[n], len - n, "&%s=", HTTP_VAR_RSSI);
+	if (n >= len)
+	{
+		return RECORD_ERROR;
+	}
+	for (int i = 0; i < fp->slots; i++)
+	{
+		n += snprintf(&buf[n], len - n, "%02x", (uint8_t)fp->rssi[i]);
+		if (n >= len)
+		{
+			return RECORD_ERROR;
+		}
+	}
+
+	return n;
+}
+#endif
@@ -0,0 +1,163 @@
+/**
+ * @file record.h
+ * @author Flynn Harrison
+ * @brief Wire format for readings sent to the collector
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "beaconBLE.h"
+#include "sdkconfig.h"
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+#include "rssiHist.h"
+#endif
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+#include "fingerprint.h"
+#endif
+
+// Record types, first byte of every binary record
+#define RECORD_TYPE_SIGHTING    0x01
+#define RECORD_TYPE_PRESENCE    0x02
+#define RECORD_TYPE_HISTOGRAM   0x03
+#define RECORD_TYPE_FINGERPRINT 0x04
+
+// Binary sighting record (little endian), uuid_32b is the beacon key (see ble_beacon_reading_t)
+// [0] type, [1..4] uuid_32b, [5] rssi, [6] TxPower, [7..8] packetGroup, [9] format
+#define RECORD_SIGHTING_LEN     10
+
+// Binary presence event record (little endian), rssi is the smoothed value
+// [0] type, [1..4] uuid_32b, [5] rssi, [6] TxPower, [7..8] packetGroup, [9] format, [10] event
+#define RECORD_PRESENCE_LEN     11
+
+// Binary RSSI histogram record (little endian), bin i counts [low + i * width, low + (i + 1) * width) dBm
+// [0] type, [1..4] uuid_32b, [5] format, [6] low, [7] width, [8] bin count, [9] min rssi, [10] max rssi,
+// [11..] bin counts (u16 each)
+#define RECORD_HISTOGRAM_LEN(bins)  (11 + 2 * (bins))
+
+// Binary fingerprint record (little endian), slot i is the i-th provisioned beacon (allowlist_position())
+// [0] type, [1..2] packetGroup, [3] slot count n, [4..7] allowlist order hash, [8..] heard bitmap
+// ((n + 7) / 8 bytes, bit i % 8 of byte i / 8 for slot i), then n mean RSSIs (int8, 0 where not heard)
+#define RECORD_FINGERPRINT_LEN(n)   (8 + ((n) + 7) / 8 + (n))
+
+// Longest query strings (excluding the terminator), every number at its widest
+#define RECORD_QUERY_SIGHTING_MAX \
+	(sizeof("rssi_submit?pkGroup=65535&uuid=255&rssi=-128&deviceID=-128&format=255&id=4294967295&event=255") - 1)
+#define RECORD_QUERY_HISTOGRAM_MAX(bins) \
+	(sizeof("rssi_hist?deviceID=-128&id=4294967295&format=255&low=-128&width=-128&min=-128&max=-128&bins=") - 1 + 6 * (bins) - 1)
+#define RECORD_QUERY_FINGERPRINT_MAX(n) \
+	(sizeof("rssi_fingerprint?deviceID=-128&pkGroup=65535&slots=255&order=4294967295&heard=&rssi=") - 1 + 2 * (((n) + 7) / 8) + 2 * (n))
+
+// Longest query any record_query_*() builds in this configuration, the HTTP(S) request
+// buffers are sized from it
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+#define RECORD_QUERY_FP_MAX     RECORD_QUERY_FINGERPRINT_MAX(FINGERPRINT_BEACONS)
+#else
+#define RECORD_QUERY_FP_MAX     0
+#endif
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+#define RECORD_QUERY_HIST_MAX   RECORD_QUERY_HISTOGRAM_MAX(RSSI_HIST_BINS)
+#else
+#define RECORD_QUERY_HIST_MAX   0
+#endif
+#define RECORD_QUERY_MAX_OF(a, b)   ((a) > (b) ? (a) : (b))
+#define RECORD_QUERY_MAX \
+	RECORD_QUERY_MAX_OF(RECORD_QUERY_SIGHTING_MAX, RECORD_QUERY_MAX_OF(RECORD_QUERY_HIST_MAX, RECORD_QUERY_FP_MAX))
+
+#define RECORD_ERROR -1
+
+/**
+ * @brief Packs a reading into a binary sighting record
+ * 
+ * @param buf output buffer
+ * @param len space left in buf
+ * @param rd reading
+ * @return int bytes written or RECORD_ERROR if buf is too small
+ */
+int record_pack_sighting(uint8_t *buf, size_t len, const ble_beacon_recived_t *rd);
+
+/**
+ * @brief Packs a presence event (rd->event) into a binary presence record
+ * 
+ * @param buf output buffer
+ * @param len space left in buf
+ * @param rd event
+ * @return int bytes written or RECORD_ERROR if buf is too small
+ */
+int record_pack_presence(uint8_t *buf, size_t len, const ble_beacon_recived_t *rd);
+
+/**
+ * @brief Packs a sighting or a presence event, whichever rd->event says it is
+ * 
+ * @param buf output buffer, RECORD_PRESENCE_LEN is always enough
+ * @param len space left in buf
+ * @param rd reading or event
+ * @return int bytes written or RECORD_ERROR if buf is too small
+ */
+int record_pack_reading(uint8_t *buf, size_t len, const ble_beacon_recived_t *rd);
+
+/**
+ * @brief Builds the rssi_submit query string for a reading or presence event (path for
+ * http_send_request)
+ * 
+ * @param buf output buffer
+ * @param len size of buf
+ * @param rd reading
+ * @return int length of the string or RECORD_ERROR if it did not fit
+ */
+int record_query_sighting(char *buf, size_t len, const ble_beacon_recived_t *rd);
+
+#if defined(CONFIG_RSSI_HIST_ENABLE)
+/**
+ * @brief Packs a beacon's RSSI histogram into a binary histogram record
+ * 
+ * @param buf output buffer
+ * @param len space left in buf
+ * @param hist 
+ * @return int bytes written or RECORD_ERROR if buf is too small
+ */
+int record_pack_histogram(uint8_t *buf, size_t len, const rssiHist_t *hist);
+
+/**
+ * @brief Builds the rssi_hist query string for a beacon's RSSI histogram
+ * 
+ * @param buf output buffer
+ * @param len size of buf
+ * @param hist 
+ * @return int length of the string or RECORD_ERROR if it did not fit
+ */
+int record_query_histogram(char *buf, size_t len, const rssiHist_t *hist);
+#endif
+
+#if defined(CONFIG_FINGERPRINT_ENABLE)
+/**
+ * @brief Packs a scan's fingerprint into a binary fingerprint record
+ * 
+ * @param buf output buffer
+ * @param len space left in buf
+ * @param fp 
+ * @return int bytes written or RECORD_ERROR if buf is too small
+ */
+int record_pack_fingerprint(uint8_t *buf, size_t len, const fingerprint_t *fp);
+
+/**
+ * @brief Builds the rssi_fingerprint query string for a scan's fingerprint, the bitmap
+ * and RSSIs are hex encoded in the binary record's layout
+ * 
+ * @param buf output buffer
+ * @param len size of buf
+ * @param fp 
+ * @return int length of the string or RECORD_ERROR if it did not fit
+ */
+int record_query_fingerprint(char *buf, size_t len, const fingerprint_t *fp);
+#endif
+
+#endif
@@ -0,0 +1,171 @@
+/**
+ * @file rssiHist.c
+ * @author Flynn Harrison
+ * @brief Fixed size per beacon RSSI histograms
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "rssiHist.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#define RSSI_HIST_INTERVAL_US (CONFIG_RSSI_HIST_INTERVAL_S * 1000000LL)
+
+// Filled by the GAP callback, taken by the uploader, possibly on the other core
+static rssiHist_t s_hist[RSSI_HIST_BEACONS];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_untracked;
+static int64_t s_intervalStartUs;
+
+void rssi_hist_add(const ble_beacon_recived_t *rd)
+{
+	rssiHist_t *hist = NULL;
+	int bin;
+
+	bin = (rd->rssi - RSSI_HIST_LOW_DBM) / RSSI_HIST_BIN_DB;
+	if (rd->rssi < RSSI_HIST_LOW_DBM)
+	{
+		bin = 0;
+	}
+	else if (bin >= RSSI_HIST_BINS)
+	{
+		bin = RSSI_HIST_BINS - 1;
+	}
+
+	taskENTER_CRITICAL(&s_lock);
+	for (int i = 0; i < RSSI_HIST_BEACONS; i++)
+	{
+		if (s_hist[i].used && memcmp(s_hist[i].uuid_32b, rd->uuid_32b, ADV_DATA_SERVICE_LEN) == 0)
+		{
+			hist = &s_hist[i];
+			break;
+		}
+		if (!s_hist[i].used && hist == NULL)
+		{
+			hist = &s_hist[i];
+		}
+	}
+
+	if (hist == NULL)
+	{
+		s_untracked++;
+	}
+	else
+	{
+		if (!hist->used)
+		{
+			memcpy(hist->uuid_32b, rd->uuid_32b, ADV_DATA_SERVICE_LEN);
+			hist->format = rd->format;
+			hist->deviceID = rd->deviceID;
+			hist->minRssi = rd->rssi;
+			hist->maxRssi = rd->rssi;
+			hist->used = 1;
+		}
+		hist->minRssi = rd->rssi < hist->minRssi ? rd->rssi : hist->minRssi;
+		hist->maxRssi = rd->rssi > hist->maxRssi ? rd->rssi : hist->maxRssi;
+		if (hist->bins[bin] < UINT16_MAX)
+		{
+			hist->bins[bin]++;
+		}
+	}
+	taskEXIT_CRITICAL(&s_lock);
+}
+
+void rssi_hist_init(void)
+{
+	s_intervalStartUs = esp_timer_get_time();
+}
+
+bool rssi_hist_due(int64_t nowUs)
+{
+	return nowUs - s_intervalStartUs >= RSSI_HIST_INTERVAL_US;
+}
+
+bool rssi_hist_take(int *index, rssiHist_t *hist)
+{
+	bool found = false;
+
+	taskENTER_CRITICAL(&s_lock);
+	for (; *index < RSSI_HIST_BEACONS && !found; (*index)++)
+	{
+		if (s_hist[*index].used)
+		{
+			*hist = s_hist[*index];
+			memset(&s_hist[*index], 0, sizeof(rssiHist_t));
+			found = true;
+		}
+	}
+	taskEXIT_CRITICAL(&s_lock);
+
+	if (!found)
+	{
+		s_intervalStartUs = esp_timer_get_time();
+	}
+
+	return found;
+}
+
+void rssi_hist_return(const rssiHist_t *hist)
+{
+	rssiHist_t *slot = NULL;
+	uint32_t sum;
+
+	taskENTER_CRITICAL(&s_lock);
+	for (int i = 0; i < RSSI_HIST_BEACONS; i++)
+	{
+		if (s_hist[i].used && memcmp(s_hist[i].uuid_32b, hist->uuid_32b, ADV_DATA_SERVICE_LEN) == 0)
+		{
+			slot = &s_hist[i];
+			break;
+		}
+		if (!s_hist[i].used && slot == NULL)
+		{
+			slot = &s_hist[i];
+		}
+	}
+
+	if (slot == NULL)
+	{
+		s_untracked += rssi_hist_samples(hist);
+	}
+	else if (!slot->used)
+	{
+		*slot = *hist;
+	}
+	else
+	{
+		slot->minRssi = hist->minRssi < slot->minRssi ? hist->minRssi : slot->minRssi;
+		slot->maxRssi = hist->maxRssi > slot->maxRssi ? hist->maxRssi : slot->maxRssi;
+		for (int i = 0; i < RSSI_HIST_BINS; i++)
+		{
+			sum = slot->bins[i] + hist->bins[i];
+			slot->bins[i] = sum < UINT16_MAX ? sum : UINT16_MAX;
+		}
+	}
+	taskEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t rssi_hist_samples(const rssiHist_t *hist)
+{
+	uint32_t samples = 0;
+
+	for (int i = 0; i < RSSI_HIST_BINS; i++)
+	{
+		samples += hist->bins[i];
+	}
+
+	return samples;
+}
+
+uint32_t rssi_hist_untracked(void)
+{
+	return s_untracked;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file rssiHist.h
+ * @author Flynn Harrison
+ * @brief Fixed size per beacon RSSI histograms for long window analytics. Every scan
+ * result is counted, the histograms are uploaded and reset once an interval.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef RSSIHIST_H
+#define RSSIHIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "beaconBLE.h"
+#include "sdkconfig.h"
+
+#define RSSI_HIST_BEACONS   CONFIG_RSSI_HIST_BEACONS
+#define RSSI_HIST_BINS      CONFIG_RSSI_HIST_BINS
+#define RSSI_HIST_LOW_DBM   CONFIG_RSSI_HIST_LOW_DBM		// Bottom of bin 0, anything weaker is counted there too
+#define RSSI_HIST_BIN_DB    CONFIG_RSSI_HIST_BIN_DB			// Width of each bin, the top bin also takes anything stronger
+
+// 10 + 2 * RSSI_HIST_BINS bytes per beacon
+typedef struct {
+	uint8_t uuid_32b[ADV_DATA_SERVICE_LEN];
+	uint8_t format;
+	int8_t deviceID;
+	int8_t minRssi;
+	int8_t maxRssi;
+	uint8_t used;
+	uint16_t bins[RSSI_HIST_BINS];		// Saturate at UINT16_MAX
+} rssiHist_t;
+
+/**
+ * @brief Counts a scan result in the beacon's histogram (GAP callback). When every
+ * histogram is in use by another beacon the sample is counted as untracked.
+ * 
+ * @param rd reading with rssi filled in
+ */
+void rssi_hist_add(const ble_beacon_recived_t *rd);
+
+/**
+ * @brief Starts the first interval, call before scanning starts
+ * 
+ */
+void rssi_hist_init(void);
+
+/**
+ * @brief True once the flush interval has passed since init or the last flush
+ * 
+ * @param nowUs esp_timer_get_time()
+ * @return true 
+ * @return false 
+ */
+bool rssi_hist_due(int64_t nowUs);
+
+/**
+ * @brief Copies out and clears the next histogram in use, starting the next interval
+ * once the last one has been taken
+ * 
+ * @param index start at 0, advanced past the histogram taken
+ * @param hist 
+ * @return true 
+ * @return false no histograms left this interval
+ */
+bool rssi_hist_take(int *index, rssiHist_t *hist);
+
+/**
+ * @brief Merges a taken histogram that could not be uploaded back in, with whatever
+ * the beacon has added since. Counted as untracked if every histogram is in use by
+ * other beacons by now.
+ * 
+ * @param hist 
+ */
+void rssi_hist_return(const rssiHist_t *hist);
+
+/**
+ * @brief Samples in a histogram
+ * 
+ * @param hist 
+ * @return uint32_t 
+ */
+uint32_t rssi_hist_samples(const rssiHist_t *hist);
+
+/**
+ * @brief Samples not counted since boot because all histograms were in use
+ * 
+ * @return uint32_t 
+ */
+uint32_t rssi_hist_untracked(void);
+
+#endif
@@ -0,0 +1,190 @@
+/**
+ * @file scanWindow.c
+ * @author Flynn Harrison
+ * @brief Decides when a scan can end early
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "scanWindow.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "trace.h"
+
+#define SCAN_EXPECT_CYCLES  CONFIG_SCAN_EXPECT_CYCLES	// A beacon heard in any of these scans is expected
+#define SCAN_EXPECT_MAX     CONFIG_SCAN_EXPECT_MAX		// Beacons remembered between scans
+#define SCAN_QUIET_US       (CONFIG_SCAN_QUIET_MS * 1000LL)
+
+typedef struct {
+	uint32_t key;
+	uint32_t lastScan;			// s_scan when last heard, 0 for a free slot
+} scan_window_entry_t;
+
+// Changed by the scan task between scans and the GAP callback during one
+static scan_window_entry_t s_seen[SCAN_EXPECT_MAX];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_scan;				// Current scan, from 1
+static uint32_t s_remaining;		// Expected beacons not heard yet this scan
+static int64_t s_startUs;
+static int64_t s_lastNewUs;			// 0 until the first beacon of the scan, the quiet timer is off till then
+static int64_t s_maxUs;
+static scan_window_reason_t s_reason;
+static scan_window_stats_t s_stats;
+
+static bool expected(const scan_window_entry_t *entry)
+{
+	return entry->lastScan != 0 && s_scan - entry->lastScan <= SCAN_EXPECT_CYCLES;
+}
+
+uint32_t scan_window_begin(int64_t nowUs, uint32_t maxMs)
+{
+	uint32_t count = 0;
+
+	taskENTER_CRITICAL(&s_lock);
+	s_scan++;
+	for (int i = 0; i < SCAN_EXPECT_MAX; i++)
+	{
+		count += expected(&s_seen[i]);
+	}
+	s_remaining = count;
+	s_startUs = nowUs;
+	s_lastNewUs = 0;
+	s_maxUs = (int64_t)maxMs * 1000;
+	s_reason = SCAN_WINDOW_CONTINUE;
+	s_stats.lastExpected = count;
+	taskEXIT_CRITICAL(&s_lock);
+
+	return count;
+}
+
+void scan_window_started(int64_t nowUs)
+{
+	taskENTER_CRITICAL(&s_lock);
+	s_startUs = nowUs;
+	taskEXIT_CRITICAL(&s_lock);
+}
+
+bool scan_window_heard(uint32_t key, int64_t nowUs)
+{
+	scan_window_entry_t *entry = NULL;
+	scan_window_entry_t *oldest = &s_seen[0];
+	bool done = false;
+
+	taskENTER_CRITICAL(&s_lock);
+	for (int i = 0; i < SCAN_EXPECT_MAX; i++)
+	{
+		if (s_seen[i].lastScan != 0 && s_seen[i].key == key)
+		{
+			entry = &s_seen[i];
+			break;
+		}
+		if (s_seen[i].lastScan < oldest->lastScan)
+		{
+			oldest = &s_seen[i];
+		}
+	}
+
+	if (entry == NULL || entry->lastScan != s_scan)
+	{
+		s_lastNewUs = nowUs;
+		if (entry != NULL && expected(entry) && s_remaining > 0)
+		{
+			done = --s_remaining == 0;
+		}
+		else if (entry == NULL && oldest->lastScan != s_scan)
+		{
+			// Free slots have lastScan 0 so they go first. A beacon that does not fit
+			// (table full of beacons heard this scan) is simply not expected next time.
+			entry = oldest;
+			entry->key = key;
+		}
+
+		if (entry != NULL)
+		{
+			entry->lastScan = s_scan;
+		}
+	}
+	taskEXIT_CRITICAL(&s_lock);
+
+	return done;
+}
+
+scan_window_reason_t scan_window_check(int64_t nowUs)
+{
+	scan_window_reason_t reason = SCAN_WINDOW_CONTINUE;
+
+	taskENTER_CRITICAL(&s_lock);
+	if (nowUs - s_startUs >= s_maxUs)
+	{
+		reason = SCAN_WINDOW_MAX;
+	}
+#if defined(CONFIG_SCAN_EARLY_STOP)
+	else if (s_stats.lastExpected > 0 && s_remaining == 0)
+	{
+		reason = SCAN_WINDOW_ALL_HEARD;
+	}
+	else if (s_lastNewUs != 0 && nowUs - s_lastNewUs >= SCAN_QUIET_US)
+	{
+		reason = SCAN_WINDOW_QUIET;
+	}
+#endif
+	s_reason = reason;
+	taskEXIT_CRITICAL(&s_lock);
+
+	return reason;
+}
+
+uint32_t scan_window_wait_ms(int64_t nowUs)
+{
+	int64_t until;
+
+	taskENTER_CRITICAL(&s_lock);
+	until = s_startUs + s_maxUs;
+#if defined(CONFIG_SCAN_EARLY_STOP)
+	if (s_lastNewUs != 0 && s_lastNewUs + SCAN_QUIET_US < until)
+	{
+		until = s_lastNewUs + SCAN_QUIET_US;
+	}
+#endif
+	taskEXIT_CRITICAL(&s_lock);
+
+	return until > nowUs ? (uint32_t)((until - nowUs + 999) / 1000) : 0;
+}
+
+scan_window_reason_t scan_window_stopped(int64_t nowUs)
+{
+	int64_t radioOn;
+	scan_window_reason_t reason;
+
+	taskENTER_CRITICAL(&s_lock);
+	radioOn = nowUs - s_startUs;
+	reason = s_reason;
+	s_stats.scans++;
+	s_stats.allHeard += reason == SCAN_WINDOW_ALL_HEARD;
+	s_stats.quiet += reason == SCAN_WINDOW_QUIET;
+	s_stats.full += reason == SCAN_WINDOW_MAX;
+	s_stats.lastRadioOnMs = (uint32_t)(radioOn / 1000);
+	s_stats.radioOnUs += radioOn;
+	if (radioOn < s_maxUs)
+	{
+		s_stats.savedUs += s_maxUs - radioOn;
+	}
+	taskEXIT_CRITICAL(&s_lock);
+
+	TRACE_POINT(TRACE_SCAN_STOP, reason, (int32_t)(radioOn / 1000), 0);
+
+	return reason;
+}
+
+void scan_window_get_stats(scan_window_stats_t *stats)
+{
+	taskENTER_CRITICAL(&s_lock);
+	*stats = s_stats;
+	taskEXIT_CRITICAL(&s_lock);
+}
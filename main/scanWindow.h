@@ -0,0 +1,98 @@
+/**
+ * @file scanWindow.h
+ * @author Flynn Harrison
+ * @brief Decides when a scan can end early. A scan stops once every beacon heard in
+ * the last few cycles has been heard again, or once no new beacon has turned up for
+ * a quiet period after the first one, and never runs past the hard maximum.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef SCANWINDOW_H
+#define SCANWINDOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+	SCAN_WINDOW_CONTINUE = 0,
+	SCAN_WINDOW_ALL_HEARD,		// Every expected beacon reported
+	SCAN_WINDOW_QUIET,			// No new beacon for the quiet period
+	SCAN_WINDOW_MAX,			// Hard maximum reached
+} scan_window_reason_t;
+
+typedef struct {
+	uint32_t scans;
+	uint32_t allHeard;			// Scans ended by each reason
+	uint32_t quiet;
+	uint32_t full;
+	uint32_t lastExpected;		// Beacons expected in the last scan
+	uint32_t lastRadioOnMs;		// Scan start complete to stop complete, last scan
+	uint64_t radioOnUs;			// Since boot
+	uint64_t savedUs;			// Radio off time gained against always scanning the maximum
+} scan_window_stats_t;
+
+/**
+ * @brief Starts a scan window (scan task, before starting the scan). Beacons heard in
+ * the last SCAN_EXPECT_CYCLES scans become the expected set.
+ * 
+ * @param nowUs esp_timer_get_time()
+ * @param maxMs hard maximum
+ * @return uint32_t beacons expected
+ */
+uint32_t scan_window_begin(int64_t nowUs, uint32_t maxMs);
+
+/**
+ * @brief Scan start complete (GAP callback), the window is timed from here
+ * 
+ * @param nowUs 
+ */
+void scan_window_started(int64_t nowUs);
+
+/**
+ * @brief A beacon was heard (GAP callback), repeats within a scan are ignored
+ * 
+ * @param key ble_beacon_key()
+ * @param nowUs 
+ * @return true this completed the expected set, the scan can stop
+ * @return false 
+ */
+bool scan_window_heard(uint32_t key, int64_t nowUs);
+
+/**
+ * @brief Whether the scan should stop now (scan task). Always SCAN_WINDOW_MAX or
+ * SCAN_WINDOW_CONTINUE when SCAN_EARLY_STOP is off.
+ * 
+ * @param nowUs 
+ * @return scan_window_reason_t 
+ */
+scan_window_reason_t scan_window_check(int64_t nowUs);
+
+/**
+ * @brief Time until scan_window_check() could change its answer without a beacon being heard
+ * 
+ * @param nowUs 
+ * @return uint32_t ms
+ */
+uint32_t scan_window_wait_ms(int64_t nowUs);
+
+/**
+ * @brief Scan stop complete (GAP callback), the radio is off from here. Counts and
+ * traces the scan under whatever scan_window_check() last decided.
+ * 
+ * @param nowUs 
+ * @return scan_window_reason_t what ended the scan
+ */
+scan_window_reason_t scan_window_stopped(int64_t nowUs);
+
+/**
+ * @brief Counters since boot
+ * 
+ * @param stats 
+ */
+void scan_window_get_stats(scan_window_stats_t *stats);
+
+#endif
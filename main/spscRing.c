@@ -0,0 +1,61 @@
+/**
+ * @file spscRing.c
+ * @author Flynn Harrison
+ * @brief Lock free single producer single consumer ring buffer
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "spscRing.h"
+
+#include <string.h>
+
+void spscRingInit(spscRing_t *ring, uint8_t *storage, uint32_t len, size_t itemSize)
+{
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	ring->slots = len + 1;
+	ring->itemSize = itemSize;
+	ring->storage = storage;
+}
+
+bool spscRingPush(spscRing_t *ring, const void *item)
+{
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	uint32_t next = head + 1 == ring->slots ? 0 : head + 1;
+
+	// Acquire pairs with the consumer's release so the slot is free before we write it
+	if (next == atomic_load_explicit(&ring->tail, memory_order_acquire))
+	{
+		return false;
+	}
+
+	memcpy(&ring->storage[head * ring->itemSize], item, ring->itemSize);
+	atomic_store_explicit(&ring->head, next, memory_order_release);
+	return true;
+}
+
+bool spscRingPop(spscRing_t *ring, void *item)
+{
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	if (tail == atomic_load_explicit(&ring->head, memory_order_acquire))
+	{
+		return false;
+	}
+
+	memcpy(item, &ring->storage[tail * ring->itemSize], ring->itemSize);
+	atomic_store_explicit(&ring->tail, tail + 1 == ring->slots ? 0 : tail + 1, memory_order_release);
+	return true;
+}
+
+uint32_t spscRingCount(spscRing_t *ring)
+{
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+	return head >= tail ? head - tail : ring->slots - tail + head;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file spscRing.h
+ * @author Flynn Harrison
+ * @brief Lock free single producer single consumer ring buffer. Safe across cores as
+ * long as only one task pushes and only one task pops.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+typedef struct {
+	atomic_uint_fast32_t head;	// Next slot to write, only the producer stores
+	atomic_uint_fast32_t tail;	// Next slot to read, only the consumer stores
+	uint32_t slots;				// One slot is always left empty
+	size_t itemSize;
+	uint8_t *storage;
+} spscRing_t;
+
+// Storage needed for a ring holding len items
+#define SPSC_RING_STORAGE_SIZE(len, itemSize) (((len) + 1) * (itemSize))
+
+/**
+ * @brief Initialise the ring, storage must be SPSC_RING_STORAGE_SIZE(len, itemSize)
+ * 
+ * @param ring 
+ * @param storage 
+ * @param len items the ring can hold
+ * @param itemSize 
+ */
+void spscRingInit(spscRing_t *ring, uint8_t *storage, uint32_t len, size_t itemSize);
+
+/**
+ * @brief Copies item into the ring (producer only)
+ * 
+ * @return true 
+ * @return false ring full
+ */
+bool spscRingPush(spscRing_t *ring, const void *item);
+
+/**
+ * @brief Copies the oldest item out of the ring (consumer only)
+ * 
+ * @return true 
+ * @return false ring empty
+ */
+bool spscRingPop(spscRing_t *ring, void *item);
+
+/**
+ * @brief Items in the ring, may be stale by the time it returns
+ * 
+ * @return uint32_t 
+ */
+uint32_t spscRingCount(spscRing_t *ring);
+
+#endif
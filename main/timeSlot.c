@@ -0,0 +1,211 @@
+/**
+ * @file timeSlot.c
+ * @author Flynn Harrison
+ * @brief Slotted scan coordination between receivers in the same area
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "timeSlot.h"
+
+#include <sys/time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_sntp.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#define SCAN_SLOT_COUNT     CONFIG_SCAN_SLOT_COUNT
+#define SCAN_SNTP_SERVER    CONFIG_SCAN_SNTP_SERVER
+#define SCAN_SLOT_GUARD_MS  CONFIG_SCAN_SLOT_GUARD_MS
+
+static const char TAG[] = "Time slot";
+
+// Sync state is written from the SNTP callback (lwIP task), the cycle boundary by the
+// scan task and read by the upload task
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_started;
+static int64_t s_syncWallUs;		// Wall clock and esp_timer at the last sync
+static int64_t s_syncTimerUs;
+static int64_t s_nextStartMs;		// Boundary the scan task is waiting for
+static int64_t s_cycleStartMs;		// Boundary of the last scan, uploads are slotted after it, 0 before the first
+static int64_t s_slotEndMs;			// End of the current upload slot, 0 when uploads are not slotted (upload path only)
+static time_slot_stats_t s_stats;
+
+static int64_t wall_ms(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+}
+
+static uint32_t abs_ms(int32_t ms)
+{
+	return ms < 0 ? -ms : ms;
+}
+
+/**
+ * @brief SNTP has just set the clock. The step from where the clock would have been
+ * is the drift since the last sync, an upper bound on how far receivers disagree.
+ * 
+ * @param tv new time
+ */
+static void time_slot_sync_cb(struct timeval *tv)
+{
+	int64_t nowUs = esp_timer_get_time();
+	int64_t wallUs = tv->tv_sec * 1000000LL + tv->tv_usec;
+	int32_t stepMs = 0;
+	bool first;
+
+	taskENTER_CRITICAL(&s_lock);
+	first = s_stats.syncs == 0;
+	if (!first)
+	{
+		stepMs = (int32_t)((wallUs - (s_syncWallUs + nowUs - s_syncTimerUs)) / 1000);
+		s_stats.lastStepMs = stepMs;
+		if (abs_ms(stepMs) > s_stats.maxStepMs)
+		{
+			s_stats.maxStepMs = abs_ms(stepMs);
+		}
+	}
+	s_syncWallUs = wallUs;
+	s_syncTimerUs = nowUs;
+	s_stats.syncs++;
+	taskEXIT_CRITICAL(&s_lock);
+
+	if (first)
+	{
+		ESP_LOGI(TAG, "Clock set, scans follow the shared cycle from now on");
+	}
+	else
+	{
+		ESP_LOGD(TAG, "Clock corrected by %d ms", (int)stepMs);
+	}
+}
+
+void time_slot_start(void)
+{
+	if (s_started)
+	{
+		return;
+	}
+	s_started = true;
+
+	sntp_setoperatingmode(SNTP_OPMODE_POLL);
+	sntp_setservername(0, SCAN_SNTP_SERVER);
+	sntp_set_time_sync_notification_cb(time_slot_sync_cb);
+	sntp_init();
+	ESP_LOGI(TAG, "Waiting for the time from %s", SCAN_SNTP_SERVER);
+}
+
+bool time_slot_synced(void)
+{
+	return __atomic_load_n(&s_stats.syncs, __ATOMIC_RELAXED) > 0;
+}
+
+void time_slot_wait_cycle(uint32_t cycleMs)
+{
+	int64_t now = wall_ms();
+	int64_t boundary = (now / cycleMs + 1) * cycleMs;
+
+	taskENTER_CRITICAL(&s_lock);
+	// Came back from the last cycle after its successor's boundary had passed
+	if (s_cycleStartMs != 0 && boundary - s_cycleStartMs > cycleMs)
+	{
+		s_stats.missedCycles++;
+	}
+	s_nextStartMs = boundary;
+	taskEXIT_CRITICAL(&s_lock);
+
+	// pdMS_TO_TICKS() rounds down, the last partial tick is waited out one tick at a time
+	vTaskDelay(pdMS_TO_TICKS(boundary - now));
+	while (wall_ms() < boundary)
+	{
+		vTaskDelay(1);
+	}
+}
+
+void time_slot_scan_starting(void)
+{
+	int64_t now = wall_ms();
+	int32_t wakeMs;
+
+	// The upload task may still be reading the last boundary, it only moves on here
+	taskENTER_CRITICAL(&s_lock);
+	if (s_nextStartMs == 0)
+	{
+		// Clock was set during a free running wait
+		taskEXIT_CRITICAL(&s_lock);
+		return;
+	}
+	s_cycleStartMs = s_nextStartMs;
+	wakeMs = (int32_t)(now - s_cycleStartMs);
+	s_stats.cycles++;
+	s_stats.lastWakeMs = wakeMs;
+	s_stats.totalWakeMs += abs_ms(wakeMs);
+	if (abs_ms(wakeMs) > s_stats.maxWakeMs)
+	{
+		s_stats.maxWakeMs = abs_ms(wakeMs);
+	}
+	taskEXIT_CRITICAL(&s_lock);
+}
+
+bool time_slot_wait_upload(int deviceID, uint32_t cycleMs, uint32_t rxMs)
+{
+	uint32_t spanMs = cycleMs - rxMs;
+	uint32_t slotMs;
+	int64_t cycleStart;
+	int64_t slotStart;
+	int64_t now;
+	bool late;
+
+	taskENTER_CRITICAL(&s_lock);
+	cycleStart = s_cycleStartMs;
+	taskEXIT_CRITICAL(&s_lock);
+	if (cycleStart == 0)
+	{
+		s_slotEndMs = 0;
+		return false;
+	}
+
+	// The last slot ends a guard before the boundary, so an upload still in flight at
+	// the end of its slot does not hold up the next scan
+	if (spanMs > SCAN_SLOT_GUARD_MS)
+	{
+		spanMs -= SCAN_SLOT_GUARD_MS;
+	}
+	slotMs = spanMs / SCAN_SLOT_COUNT;
+	slotStart = cycleStart + rxMs + (uint32_t)deviceID % SCAN_SLOT_COUNT * slotMs;
+	s_slotEndMs = slotStart + slotMs;
+	now = wall_ms();
+	late = now >= s_slotEndMs;
+	if (!late && now < slotStart)
+	{
+		vTaskDelay(pdMS_TO_TICKS(slotStart - now));
+	}
+
+	taskENTER_CRITICAL(&s_lock);
+	s_stats.uploads++;
+	s_stats.lateUploads += late;
+	taskEXIT_CRITICAL(&s_lock);
+
+	return true;
+}
+
+bool time_slot_upload_open(void)
+{
+	return s_slotEndMs == 0 || wall_ms() < s_slotEndMs;
+}
+
+void time_slot_get_stats(time_slot_stats_t *stats)
+{
+	taskENTER_CRITICAL(&s_lock);
+	*stats = s_stats;
+	taskEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,90 @@
+/**
+ * @file timeSlot.h
+ * @author Flynn Harrison
+ * @brief Slotted scan coordination between receivers in the same area. Once the clock
+ * is set over SNTP every receiver starts its scan on the same wall clock cycle
+ * boundary, so scan windows line up, and uploads in its own slot after the scan
+ * (device ID modulo SCAN_SLOT_COUNT), so neighbours do not contend for the channel.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef TIMESLOT_H
+#define TIMESLOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+	uint32_t syncs;				// SNTP updates
+	int32_t lastStepMs;			// Clock correction at the last update (drift since the one before)
+	uint32_t maxStepMs;			// Largest correction magnitude, first sync excluded, bounds the skew between receivers
+	uint32_t cycles;			// Scans started on a boundary
+	uint32_t missedCycles;		// Boundaries passed before the scan task got back to wait for them
+	int32_t lastWakeMs;			// Scan start minus the boundary, last cycle. The task's own wake up
+	uint32_t maxWakeMs;			// latency, says nothing about other receivers.
+	uint64_t totalWakeMs;		// Sum of wake up latencies, for the mean
+	uint32_t uploads;			// Upload slots waited for
+	uint32_t lateUploads;		// Slot had already passed, nothing uploaded that cycle
+} time_slot_stats_t;
+
+/**
+ * @brief Starts SNTP (network up, repeat calls do nothing)
+ * 
+ */
+void time_slot_start(void);
+
+/**
+ * @brief True once the clock has been set, until then the scan cycle free runs
+ * 
+ * @return true
+ * @return false
+ */
+bool time_slot_synced(void);
+
+/**
+ * @brief Waits for the next wall clock multiple of cycleMs (scan task)
+ * 
+ * @param cycleMs must be the same on every receiver
+ */
+void time_slot_wait_cycle(uint32_t cycleMs);
+
+/**
+ * @brief Records the alignment error, call right before starting the scan
+ * 
+ */
+void time_slot_scan_starting(void);
+
+/**
+ * @brief Waits for this receiver's upload slot in the current cycle. The slots
+ * split the time between the longest scan and SCAN_SLOT_GUARD_MS before the next
+ * boundary.
+ * 
+ * @param deviceID
+ * @param cycleMs
+ * @param rxMs longest scan
+ * @return true waited for the slot (or it had passed)
+ * @return false no aligned cycle yet, the caller paces uploads itself
+ */
+bool time_slot_wait_upload(int deviceID, uint32_t cycleMs, uint32_t rxMs);
+
+/**
+ * @brief Whether the slot time_slot_wait_upload() waited for is still open, uploads
+ * stop starting new requests once it has closed. Always true when it returned false.
+ * 
+ * @return true
+ * @return false
+ */
+bool time_slot_upload_open(void);
+
+/**
+ * @brief Counters since boot
+ * 
+ * @param stats
+ */
+void time_slot_get_stats(time_slot_stats_t *stats);
+
+#endif
@@ -0,0 +1,135 @@
+/**
+ * @file trace.c
+ * @author Flynn Harrison
+ * @brief Deferred binary tracing for hot paths
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "hal/cpu_hal.h"
+
+#include "spscRing.h"
+#include "memReport.h"
+#include "scanWindow.h"
+
+#define TRACE_RING_LEN      CONFIG_TRACE_RING_LEN
+#define TRACE_DRAIN_MS      CONFIG_TRACE_DRAIN_MS
+#define TRACE_TASK_STACK    CONFIG_TRACE_TASK_STACK_SIZE
+#define TRACE_TASK_PRIO     1		// Below everything but idle
+
+#define TRACE_LINE_LEN      96
+
+static const char TAG[] = "Trace";
+
+// Producer is whichever task holds the trace points, consumer the drain task
+static uint8_t s_ringStorage[SPSC_RING_STORAGE_SIZE(TRACE_RING_LEN, sizeof(trace_event_t))];
+static spscRing_t s_ring;
+static atomic_uint_fast32_t s_dropped;
+
+#if defined(CONFIG_STATIC_ALLOCATION)
+static StackType_t s_taskStack[TRACE_TASK_STACK];
+static StaticTask_t s_taskBuffer;
+#endif
+
+static void vTraceDrainTask(void *pvParameters);
+
+esp_err_t trace_init(int core)
+{
+	TaskHandle_t handle = NULL;
+
+	spscRingInit(&s_ring, s_ringStorage, TRACE_RING_LEN, sizeof(trace_event_t));
+	atomic_init(&s_dropped, 0);
+
+#if defined(CONFIG_STATIC_ALLOCATION)
+	handle = xTaskCreateStaticPinnedToCore(vTraceDrainTask, "Trace", TRACE_TASK_STACK, NULL, TRACE_TASK_PRIO, s_taskStack, &s_taskBuffer, core);
+#else
+	xTaskCreatePinnedToCore(vTraceDrainTask, "Trace", TRACE_TASK_STACK, NULL, TRACE_TASK_PRIO, &handle, core);
+#endif
+	if (handle == NULL)
+	{
+		return ESP_ERR_NO_MEM;
+	}
+
+	memReportRegisterTask(handle, TRACE_TASK_STACK);
+	return ESP_OK;
+}
+
+void trace_write(uint16_t id, int16_t a, int32_t b, int32_t c)
+{
+	trace_event_t event = {
+		.cycles = cpu_hal_get_cycle_count(),
+		.id = id,
+		.a = a,
+		.b = b,
+		.c = c
+	};
+
+	if (!spscRingPush(&s_ring, &event))
+	{
+		atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+	}
+}
+
+int trace_format(char *buf, size_t len, const trace_event_t *event)
+{
+	switch (event->id)
+	{
+	case TRACE_SCAN_START:
+		return snprintf(buf, len, "Scan started, packet group %d", event->a);
+	case TRACE_SCAN_RESULT:
+		return snprintf(buf, len, "Scan result event %d, %d bytes", event->a, (int)event->b);
+	case TRACE_BEACON_FOUND:
+		return snprintf(buf, len, "Beacon %08x found, format %d, TxPower %d dBm, RSSI %d dBm",
+			(unsigned int)event->b, (int)(event->c >> 8), (int8_t)(event->c & 0xFF), event->a);
+	case TRACE_BEACON_DUPLICATE:
+		return snprintf(buf, len, "Beacon %08x already heard this scan", (unsigned int)event->b);
+	case TRACE_HANDOFF_FULL:
+		return snprintf(buf, len, "Beacon %08x dropped, handoff full", (unsigned int)event->b);
+	case TRACE_BEACON_REJECTED:
+		return snprintf(buf, len, "Beacon %08x not in allowlist", (unsigned int)event->b);
+	case TRACE_SCAN_STOP:
+		return snprintf(buf, len, "Scan stopped after %d ms (%s)", (int)event->b,
+			event->a == SCAN_WINDOW_ALL_HEARD ? "all heard" : event->a == SCAN_WINDOW_QUIET ? "quiet" : "max window");
+	default:
+		return snprintf(buf, len, "Unknown event %u (%d %d %d)", event->id, event->a, (int)event->b, (int)event->c);
+	}
+}
+
+static void vTraceDrainTask(void *pvParameters)
+{
+	trace_event_t event;
+	char line[TRACE_LINE_LEN];
+	uint32_t ticksPerUs = esp_rom_get_cpu_ticks_per_us();
+	uint32_t prevCycles = 0;
+	uint32_t dropped;
+
+	for(;;){
+		vTaskDelay(pdMS_TO_TICKS(TRACE_DRAIN_MS));
+
+		while (spscRingPop(&s_ring, &event)){
+			trace_format(line, sizeof(line), &event);
+			// Relative to the previous event, the cycle counter wraps within a minute
+			ESP_LOGI(TAG, "+%6u us %s", (unsigned int)((uint32_t)(event.cycles - prevCycles) / ticksPerUs), line);
+			prevCycles = event.cycles;
+		}
+
+		dropped = atomic_exchange_explicit(&s_dropped, 0, memory_order_relaxed);
+		if (dropped > 0){
+			ESP_LOGW(TAG, "%u events dropped, ring full (TRACE_RING_LEN)", (unsigned int)dropped);
+		}
+	}
+
+	vTaskDelete(NULL);
+}
@@ -0,0 +1,77 @@
+/**
+ * @file trace.h
+ * @author Flynn Harrison
+ * @brief Deferred binary tracing for hot paths. A trace point copies a fixed size
+ * event into a lock free ring, a low priority task turns them into log lines later.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// Trace point IDs, trace_format() in trace.c holds the text for each
+typedef enum {
+	TRACE_SCAN_START = 1,		// a packetGroup
+	TRACE_SCAN_RESULT,			// a search_evt, b adv_data_len + scan_rsp_len
+	TRACE_BEACON_FOUND,			// a rssi, b key, c format << 8 | TxPower
+	TRACE_BEACON_DUPLICATE,		// b key
+	TRACE_HANDOFF_FULL,			// b key
+	TRACE_BEACON_REJECTED,		// b key, not in the allowlist
+	TRACE_SCAN_STOP,			// a scan_window_reason_t, b radio on ms
+	TRACE_ID_COUNT
+} trace_id_t;
+
+typedef struct {
+	uint32_t cycles;			// CPU cycle count when written
+	uint16_t id;				// trace_id_t
+	int16_t a;
+	int32_t b;
+	int32_t c;
+} trace_event_t;
+
+#if defined(CONFIG_TRACE_ENABLE)
+#define TRACE_POINT(id, a, b, c) trace_write((id), (a), (b), (c))
+#else
+#define TRACE_POINT(id, a, b, c) do {} while (0)
+#endif
+
+/**
+ * @brief Sets up the ring and starts the low priority task that logs it
+ * 
+ * @param core core to run the task on or tskNO_AFFINITY
+ * @return esp_err_t
+ */
+esp_err_t trace_init(int core);
+
+/**
+ * @brief Records an event, dropped (and counted) if the ring is full. Every trace
+ * point must be in the same task (the Bluedroid task), the ring is single producer.
+ * 
+ * @param id trace_id_t
+ * @param a
+ * @param b
+ * @param c
+ */
+void trace_write(uint16_t id, int16_t a, int32_t b, int32_t c);
+
+/**
+ * @brief Formats an event without its timestamp, used by the drain task
+ * 
+ * @param buf
+ * @param len
+ * @param event
+ * @return int snprintf result
+ */
+int trace_format(char *buf, size_t len, const trace_event_t *event);
+
+#endif
@@ -0,0 +1,174 @@
+/**
+ * @file uartSink.c
+ * @author Flynn Harrison
+ * @brief Wired output over UART
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "uartSink.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "driver/uart.h"
+#include "sdkconfig.h"
+
+#define UART_SINK_PORT      CONFIG_UPLOAD_UART_PORT
+#define UART_SINK_BAUD      CONFIG_UPLOAD_UART_BAUD
+#define UART_SINK_TX_PIN    CONFIG_UPLOAD_UART_TX_PIN
+#define UART_SINK_TX_BUFF   CONFIG_UPLOAD_UART_TX_BUFF_SIZE
+#define UART_SINK_RX_BUFF   256		// Driver minimum, nothing is read
+
+#define FRAME_LEN           (UART_SINK_HEADER_LEN + UART_SINK_MAX_RECORD + UART_SINK_CRC_LEN)
+#define ENCODED_LEN         (FRAME_LEN + FRAME_LEN / 254 + 2)		// COBS overhead plus the delimiter
+
+static const char TAG[] = "UART sink";
+
+// Only the upload path sends, from a single task
+static uint16_t s_seq;
+static uart_sink_stats_t s_stats;
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+ * 
+ * @param data 
+ * @param len 
+ * @return uint16_t 
+ */
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+	uint16_t crc = 0xFFFF;
+
+	while (len--)
+	{
+		crc ^= (uint16_t)*data++ << 8;
+		for (int i = 0; i < 8; i++)
+		{
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+
+	return crc;
+}
+
+/**
+ * @brief Consistent overhead byte stuffing, out holds no zeros so 0x00 can end the frame
+ * 
+ * @param in 
+ * @param len 
+ * @param out at least len + len / 254 + 1
+ * @return size_t encoded length
+ */
+static size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+	size_t code = 0;		// Where the current block's length byte goes
+	size_t n = 1;
+	uint8_t run = 1;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		if (in[i] != 0)
+		{
+			out[n++] = in[i];
+			run++;
+		}
+		if (in[i] == 0 || run == 0xFF)
+		{
+			out[code] = run;
+			code = n++;
+			run = 1;
+		}
+	}
+	out[code] = run;
+
+	return n;
+}
+
+esp_err_t uart_sink_init(void)
+{
+	esp_err_t ret;
+
+	const uart_config_t config = {
+		.baud_rate = UART_SINK_BAUD,
+		.data_bits = UART_DATA_8_BITS,
+		.parity = UART_PARITY_DISABLE,
+		.stop_bits = UART_STOP_BITS_1,
+		.flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+		.source_clk = UART_SCLK_APB,
+	};
+
+	// The driver's TX ring buffer is drained into the FIFO from its ISR, writes only copy
+	ret = uart_driver_install(UART_SINK_PORT, UART_SINK_RX_BUFF, UART_SINK_TX_BUFF, 0, NULL, 0);
+	if (ret == ESP_OK){
+		ret = uart_param_config(UART_SINK_PORT, &config);
+	}
+	if (ret == ESP_OK){
+		ret = uart_set_pin(UART_SINK_PORT, UART_SINK_TX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+	}
+
+	if (ret != ESP_OK){
+		ESP_LOGE(TAG, "Failed to set up UART%d: %s", UART_SINK_PORT, esp_err_to_name(ret));
+		return ret;
+	}
+
+	ESP_LOGI(TAG, "Streaming records on UART%d TX pin %d at %d baud", UART_SINK_PORT, UART_SINK_TX_PIN, UART_SINK_BAUD);
+	return ESP_OK;
+}
+
+int uart_sink_send(int8_t deviceID, const uint8_t *record, int len)
+{
+	uint8_t frame[FRAME_LEN];
+	uint8_t encoded[ENCODED_LEN];
+	size_t frameLen;
+	size_t encodedLen;
+	size_t space = 0;
+	uint16_t crc;
+
+	if (len <= 0 || len > UART_SINK_MAX_RECORD)
+	{
+		return UART_SINK_ERROR;
+	}
+
+	frame[0] = UART_SINK_VERSION;
+	frame[1] = (uint8_t)deviceID;
+	frame[2] = s_seq & 0xFF;
+	frame[3] = (s_seq >> 8) & 0xFF;
+	memcpy(&frame[UART_SINK_HEADER_LEN], record, len);
+	frameLen = UART_SINK_HEADER_LEN + len;
+	crc = crc16(frame, frameLen);
+	frame[frameLen++] = crc & 0xFF;
+	frame[frameLen++] = (crc >> 8) & 0xFF;
+
+	encodedLen = cobs_encode(frame, frameLen, encoded);
+	encoded[encodedLen++] = 0x00;
+
+	// A partial frame would corrupt the next one too, drop it whole instead of waiting.
+	// The sequence still advances so the reader sees the gap.
+	s_seq++;
+	if (uart_get_tx_buffer_free_size(UART_SINK_PORT, &space) != ESP_OK || space < encodedLen)
+	{
+		s_stats.dropped++;
+		return UART_SINK_ERROR;
+	}
+
+	if (uart_write_bytes(UART_SINK_PORT, encoded, encodedLen) != (int)encodedLen)
+	{
+		s_stats.dropped++;
+		return UART_SINK_ERROR;
+	}
+
+	s_stats.frames++;
+	s_stats.bytes += encodedLen;
+	return 0;
+}
+
+void uart_sink_get_stats(uart_sink_stats_t *stats)
+{
+	*stats = s_stats;
+}
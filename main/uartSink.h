@@ -0,0 +1,60 @@
+/**
+ * @file uartSink.h
+ * @author Flynn Harrison
+ * @brief Wired output for receivers next to a gateway. Records (see record.h) are
+ * streamed over UART as COBS framed packets with a CRC, no WiFi needed.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef UARTSINK_H
+#define UARTSINK_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define UART_SINK_ERROR -1
+
+// Frame before COBS encoding (little endian), every frame is followed by a 0x00
+// [0] version, [1] deviceID, [2..3] seq, [4..] one record, then CRC-16/CCITT-FALSE of everything before it
+#define UART_SINK_VERSION       1
+#define UART_SINK_HEADER_LEN    4
+#define UART_SINK_CRC_LEN       2
+#define UART_SINK_MAX_RECORD    128
+
+typedef struct {
+	uint32_t frames;			// Queued for the UART
+	uint32_t bytes;				// On the wire, framing included
+	uint32_t dropped;			// Not enough room in the TX buffer
+} uart_sink_stats_t;
+
+/**
+ * @brief Installs the UART driver with a TX ring buffer
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t uart_sink_init(void);
+
+/**
+ * @brief Frames a record and queues it for the UART. Never blocks, the frame is
+ * dropped (and counted) if the TX buffer cannot take all of it.
+ * 
+ * @param deviceID receiver the record is from
+ * @param record 
+ * @param len record length, at most UART_SINK_MAX_RECORD
+ * @return int 0 or UART_SINK_ERROR
+ */
+int uart_sink_send(int8_t deviceID, const uint8_t *record, int len);
+
+/**
+ * @brief Counters since boot
+ * 
+ * @param stats 
+ */
+void uart_sink_get_stats(uart_sink_stats_t *stats);
+
+#endif
@@ -0,0 +1,406 @@
+/**
+ * @file udp.c
+ * @author Flynn Harrison
+ * @brief Lightweight datagram transport to the collector
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#include "udp.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include "lwip/err.h"
+#include "lwip/sockets.h"
+#include "lwip/sys.h"
+#include "lwip/netdb.h"
+
+#include "record.h"
+#include "profile.h"
+#include "compress.h"
+#include "pacer.h"
+#include "params.h"
+
+#define UDP_WINDOW          CONFIG_UPLOAD_UDP_WINDOW            // Datagrams that can be awaiting an ack
+#define UDP_ACK_TIMEOUT_MS  CONFIG_UPLOAD_UDP_ACK_TIMEOUT_MS    // Wait for acks before retransmitting
+#define UDP_MAX_ROUNDS      CONFIG_UPLOAD_UDP_MAX_ROUNDS        // Transmit rounds per flush, leftovers wait for the next flush
+#define UDP_ACK_LEN         (UDP_HEADER_LEN + 4)
+#define UDP_ACK_RETRY_LEN   (UDP_ACK_LEN + 2)		// Ack carrying UDP_ACK_FLAG_RETRY_AFTER
+#define UDP_ACK_PARAMS_MAX  128						// Pushed parameter text
+#define UDP_ACK_MAX_LEN     (UDP_ACK_RETRY_LEN + UDP_ACK_PARAMS_MAX)
+#define UDP_MAX_RECORDS     255
+
+typedef struct {
+	bool inUse;
+	uint16_t seq;
+	uint16_t len;
+	uint8_t buf[UDP_MAX_DATAGRAM];
+} udp_slot_t;
+
+static const char TAG[] = "UDP api";
+
+// Retransmit window, datagrams stay here until acknowledged
+static udp_slot_t s_window[UDP_WINDOW];
+
+// Datagram currently being filled
+static uint8_t s_pending[UDP_MAX_DATAGRAM];
+static size_t s_pendingLen = 0;
+
+static int s_sock = -1;
+static uint16_t s_session = 0;		// Random per boot so the collector can tell a reboot from a replay
+static uint16_t s_nextSeq = 0;
+static bool s_peerCompress = false;	// Collector has advertised UDP_ACK_FLAG_COMPRESSION
+
+static int udp_open(const char* url, const char* port);
+static void udp_close(void);
+static int udp_seal(void);
+static int udp_transmit(const char* url, const char* port);
+static void udp_handle_ack(const uint8_t *buf, int len);
+static int udp_window_used(void);
+static size_t udp_compress(uint8_t *out);
+
+static void put_u16(uint8_t *buf, uint16_t val)
+{
+	buf[0] = val & 0xFF;
+	buf[1] = (val >> 8) & 0xFF;
+}
+
+int udp_add_reading(const char* url, const char* port, const ble_beacon_recived_t *rd)
+{
+	uint8_t record[RECORD_PRESENCE_LEN];
+	int n;
+
+	n = record_pack_reading(record, sizeof(record), rd);
+	return udp_add_record(url, port, rd->deviceID, record, n);
+}
+
+int udp_add_record(const char* url, const char* port, int8_t deviceID, const uint8_t *record, int len)
+{
+	if (len <= 0 || len > UDP_MAX_DATAGRAM - UDP_HEADER_LEN - 1)
+	{
+		return UDP_ERROR;
+	}
+
+	// Start a new datagram
+	if (s_pendingLen == 0)
+	{
+		s_pending[0] = UDP_MAGIC_0;
+		s_pending[1] = UDP_MAGIC_1;
+		s_pending[2] = UDP_VERSION;
+		s_pending[3] = UDP_TYPE_DATA;
+		s_pending[4] = (uint8_t)deviceID;
+		s_pending[5] = 0;
+		s_pending[UDP_HEADER_LEN] = 0;
+		s_pendingLen = UDP_HEADER_LEN + 1;
+	}
+
+	if (len > UDP_MAX_DATAGRAM - s_pendingLen || s_pending[UDP_HEADER_LEN] == UDP_MAX_RECORDS)
+	{
+		// Datagram full, move it to the window (making room if needed) and retry
+		if (udp_seal() == UDP_ERROR)
+		{
+			udp_transmit(url, port);
+			if (udp_seal() == UDP_ERROR)
+			{
+				ESP_LOGE(TAG, "Retransmit window full, dropping reading");
+				return UDP_ERROR;
+			}
+		}
+		return udp_add_record(url, port, deviceID, record, len);
+	}
+
+	memcpy(&s_pending[s_pendingLen], record, len);
+	s_pendingLen += len;
+	s_pending[UDP_HEADER_LEN]++;
+	return 0;
+}
+
+int udp_flush(const char* url, const char* port)
+{
+	if (udp_seal() == UDP_ERROR)
+	{
+		udp_transmit(url, port);
+		udp_seal();
+	}
+
+	return udp_transmit(url, port);
+}
+
+void udp_disconnect(void)
+{
+	udp_close();
+}
+
+/**
+ * @brief Moves the pending datagram into a free window slot
+ * 
+ * @return int 0 or UDP_ERROR if the window is full
+ */
+static int udp_seal(void)
+{
+	if (s_pendingLen == 0)
+	{
+		return 0;
+	}
+
+	if (s_session == 0)
+	{
+		s_session = (esp_random() & 0xFFFF) | 1;
+	}
+
+	for (int i = 0; i < UDP_WINDOW; i++)
+	{
+		if (!s_window[i].inUse)
+		{
+			put_u16(&s_pending[6], s_session);
+			put_u16(&s_pending[8], s_nextSeq);
+			memcpy(s_window[i].buf, s_pending, UDP_HEADER_LEN);
+			s_window[i].len = udp_compress(s_window[i].buf);
+			s_window[i].seq = s_nextSeq++;
+			s_window[i].inUse = true;
+			s_pendingLen = 0;
+			return 0;
+		}
+	}
+
+	return UDP_ERROR;
+}
+
+/**
+ * @brief Sends every unacknowledged datagram and collects acks, for up to UDP_MAX_ROUNDS
+ * 
+ * @return int datagrams still unacknowledged or UDP_ERROR
+ */
+static int udp_transmit(const char* url, const char* port)
+{
+	uint8_t rxBuff[UDP_ACK_MAX_LEN];
+	struct timeval tv;
+	TickType_t start;
+	TickType_t timeout = pdMS_TO_TICKS(UDP_ACK_TIMEOUT_MS);
+	TickType_t elapsed;
+	uint32_t waitMs;
+	int n;
+
+	if (udp_window_used() == 0)
+	{
+		return 0;
+	}
+
+	if (s_sock < 0 && udp_open(url, port) == UDP_ERROR)
+	{
+		return UDP_ERROR;
+	}
+
+	for (int round = 0; round < UDP_MAX_ROUNDS && udp_window_used() > 0; round++)
+	{
+		// A hold off from an earlier ack leaves the window for the next flush after it
+		if (pacer_holding())
+		{
+			break;
+		}
+
+		for (int i = 0; i < UDP_WINDOW; i++)
+		{
+			if (!s_window[i].inUse)
+			{
+				continue;
+			}
+
+			pacer_wait();
+			PROFILE_BEGIN(PROFILE_WRITE);
+			n = send(s_sock, s_window[i].buf, s_window[i].len, 0);
+			PROFILE_END(PROFILE_WRITE);
+			if (n < 0)
+			{
+				ESP_LOGE(TAG, "Failed to send datagram %d", s_window[i].seq);
+				udp_close();
+				return UDP_ERROR;
+			}
+		}
+
+		// Collect acks until the window empties or the round times out
+		PROFILE_BEGIN(PROFILE_READ);
+		// Elapsed ticks rather than a deadline, stays correct when the tick count wraps
+		start = xTaskGetTickCount();
+		while (udp_window_used() > 0 && (elapsed = xTaskGetTickCount() - start) < timeout)
+		{
+			waitMs = (timeout - elapsed) * portTICK_PERIOD_MS;
+			tv.tv_sec = waitMs / 1000;
+			tv.tv_usec = (waitMs % 1000) * 1000;
+			setsockopt(s_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+			n = recv(s_sock, rxBuff, sizeof(rxBuff), 0);
+			if (n < 0)
+			{
+				break;
+			}
+			udp_handle_ack(rxBuff, n);
+		}
+		PROFILE_END(PROFILE_READ);
+
+		if (udp_window_used() > 0)
+		{
+			ESP_LOGD(TAG, "%d datagrams unacknowledged after round %d", udp_window_used(), round);
+		}
+	}
+
+	return udp_window_used();
+}
+
+static void udp_handle_ack(const uint8_t *buf, int len)
+{
+	char params[UDP_ACK_MAX_LEN - UDP_ACK_LEN + 1];
+	uint16_t session;
+	uint16_t ackSeq;
+	uint32_t bitmap;
+	uint16_t d;
+	int off = UDP_ACK_LEN;
+
+	if (len < UDP_ACK_LEN || buf[0] != UDP_MAGIC_0 || buf[1] != UDP_MAGIC_1 || buf[2] != UDP_VERSION || buf[3] != UDP_TYPE_ACK)
+	{
+		ESP_LOGD(TAG, "Ignoring malformed ack");
+		return;
+	}
+
+#if defined(CONFIG_UPLOAD_COMPRESSION)
+	if ((buf[5] & UDP_ACK_FLAG_COMPRESSION) && !s_peerCompress)
+	{
+		ESP_LOGI(TAG, "Collector accepts compressed datagrams");
+		s_peerCompress = true;
+	}
+#endif
+
+	session = buf[6] | (buf[7] << 8);
+	ackSeq = buf[8] | (buf[9] << 8);
+	bitmap = buf[10] | (buf[11] << 8) | (buf[12] << 16) | ((uint32_t)buf[13] << 24);
+	if (session != s_session)
+	{
+		return;
+	}
+
+	// Collector is overloaded, retry after is in 100 ms units
+	if ((buf[5] & UDP_ACK_FLAG_RETRY_AFTER) && len >= UDP_ACK_RETRY_LEN)
+	{
+		pacer_hold_off((buf[14] | (buf[15] << 8)) * 100);
+		off = UDP_ACK_RETRY_LEN;
+	}
+
+	// Applied by the scan task at the start of the next cycle
+	if ((buf[5] & UDP_ACK_FLAG_PARAMS) && len > off)
+	{
+		memcpy(params, &buf[off], len - off);
+		params[len - off] = '\0';
+		params_push(params);
+	}
+
+	// Bit d acknowledges ackSeq - d
+	for (int i = 0; i < UDP_WINDOW; i++)
+	{
+		d = (uint16_t)(ackSeq - s_window[i].seq);
+		if (s_window[i].inUse && d < 32 && (bitmap & (1UL << d)))
+		{
+			s_window[i].inUse = false;
+		}
+	}
+}
+
+/**
+ * @brief Copies the pending payload after the header in out, compressed if the
+ * collector accepts it and it comes out smaller
+ * 
+ * @param out datagram with the header already filled in
+ * @return size_t datagram length
+ */
+static size_t udp_compress(uint8_t *out)
+{
+	size_t rawLen = s_pendingLen - UDP_HEADER_LEN;
+	int64_t start;
+	int n;
+
+	if (s_peerCompress)
+	{
+		start = esp_timer_get_time();
+		n = compress_lz(&s_pending[UDP_HEADER_LEN], rawLen, &out[UDP_HEADER_LEN], rawLen - 1);
+		compress_record_batch(rawLen, n == COMPRESS_ERROR ? rawLen : n, (uint32_t)(esp_timer_get_time() - start));
+		if (n != COMPRESS_ERROR)
+		{
+			out[5] |= UDP_FLAG_COMPRESSED;
+			return UDP_HEADER_LEN + n;
+		}
+	}
+
+	memcpy(&out[UDP_HEADER_LEN], &s_pending[UDP_HEADER_LEN], rawLen);
+	return s_pendingLen;
+}
+
+static int udp_window_used(void)
+{
+	int used = 0;
+
+	for (int i = 0; i < UDP_WINDOW; i++)
+	{
+		used += s_window[i].inUse;
+	}
+
+	return used;
+}
+
+static int udp_open(const char* url, const char* port)
+{
+	struct addrinfo *res;
+	int err;
+
+	const struct addrinfo hints = {
+		.ai_family = AF_INET,			// IPv4
+		.ai_socktype = SOCK_DGRAM,		// UDP
+	};
+
+	PROFILE_BEGIN(PROFILE_DNS);
+	err = getaddrinfo(url, port, &hints, &res);
+	PROFILE_END(PROFILE_DNS);
+	if (err != 0){
+		ESP_LOGE(TAG, "DNS lookup failed");
+		return UDP_ERROR;
+	}
+
+	s_sock = socket(res->ai_family, res->ai_socktype, 0);
+	if (s_sock < 0){
+		ESP_LOGE(TAG, "Failed to create socket");
+		freeaddrinfo(res);
+		return UDP_ERROR;
+	}
+
+	// Connected UDP socket so recv only sees the collector
+	PROFILE_BEGIN(PROFILE_CONNECT);
+	err = connect(s_sock, res->ai_addr, res->ai_addrlen);
+	PROFILE_END(PROFILE_CONNECT);
+	if (err != 0){
+		ESP_LOGE(TAG, "Failed to connect to collector %s", url);
+		freeaddrinfo(res);
+		udp_close();
+		return UDP_ERROR;
+	}
+
+	freeaddrinfo(res);
+	return 0;
+}
+
+static void udp_close(void)
+{
+	if (s_sock >= 0)
+	{
+		close(s_sock);
+		s_sock = -1;
+	}
+}
@@ -0,0 +1,81 @@
+/**
+ * @file udp.h
+ * @author Flynn Harrison
+ * @brief Lightweight datagram transport to the collector. Readings are packed into
+ * sequenced datagrams which the collector selectively acknowledges, anything
+ * unacknowledged is retransmitted.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ */
+
+#ifndef UDP_H
+#define UDP_H
+
+#include <stdint.h>
+
+#include "beaconBLE.h"
+
+#define UDP_ERROR -1
+
+// Datagram header (little endian)
+// [0..1] 'F','H', [2] version, [3] type, [4] deviceID, [5] flags, [6..7] session, [8..9] seq
+#define UDP_MAGIC_0         'F'
+#define UDP_MAGIC_1         'H'
+#define UDP_VERSION         2
+#define UDP_HEADER_LEN      10
+
+#define UDP_TYPE_DATA       0x01    // Payload: [0] record count, followed by records
+#define UDP_TYPE_ACK        0x02    // Payload: [0..3] bitmap, bit i acknowledges seq - i, [4..5] retry after, then params text
+
+#define UDP_FLAG_COMPRESSED         0x01    // Data: payload is compress_lz output
+#define UDP_ACK_FLAG_COMPRESSION    0x01    // Ack: collector accepts compressed payloads
+#define UDP_ACK_FLAG_RETRY_AFTER    0x02    // Ack: hold off uploads for retry after * 100 ms
+#define UDP_ACK_FLAG_PARAMS         0x04    // Ack: rest of the datagram is "name=value,..." (see params.h)
+
+#define UDP_MAX_DATAGRAM    256     // Keep well under the minimum MTU
+
+/**
+ * @brief Adds a reading to the datagram being built. Full datagrams are moved into
+ * the retransmit window, which is flushed first if it has no free slots.
+ * 
+ * @param url collector address
+ * @param port collector port
+ * @param rd reading
+ * @return int 0 or UDP_ERROR if the reading could not be buffered
+ */
+int udp_add_reading(const char* url, const char* port, const ble_beacon_recived_t *rd);
+
+/**
+ * @brief Adds an already packed record (see record.h) to the datagram being built,
+ * same as udp_add_reading()
+ * 
+ * @param url collector address
+ * @param port collector port
+ * @param deviceID receiver the record is from
+ * @param record 
+ * @param len record length
+ * @return int 0 or UDP_ERROR if the record could not be buffered
+ */
+int udp_add_record(const char* url, const char* port, int8_t deviceID, const uint8_t *record, int len);
+
+/**
+ * @brief Sends the pending datagram and everything still unacknowledged, then waits
+ * for acknowledgements, retransmitting on timeout.
+ * 
+ * @param url collector address
+ * @param port collector port
+ * @return int number of datagrams still unacknowledged or UDP_ERROR
+ */
+int udp_flush(const char* url, const char* port);
+
+/**
+ * @brief Closes the socket so the next flush resolves the collector again (the
+ * address changed). Datagrams awaiting an ack are kept.
+ * 
+ */
+void udp_disconnect(void);
+
+#endif
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Builds the beacon allowlist for a receiver's NVS partition (see main/allowlist.h).
+
+IDs are the beacon keys the receiver logs and uploads, 8 hex digits (uuid_32b, for
+our own tags 'FYPA' is 46595041), or a foreign beacon's full ID in hex (iBeacon
+UUID+major+minor or AltBeacon ID, 40 digits, Eddystone namespace+instance, 32
+digits), which is hashed into its key the same way the receiver does. The output CSV is
+for ESP-IDF's nvs_partition_gen.py. With IDF_PATH set the partition image is
+generated too, flash it without touching the app:
+
+    python3 tools/allowlist.py 46595041 46595042 --file ids.txt --param device_id=3
+    parttool.py write_partition --partition-name nvs --input allowlist.bin
+
+Writing the partition replaces everything in NVS, including the receiver's
+parameters (namespace "params", main/params.h) and any values the collector
+pushed. Give them with --param so they go in the same image, anything left out
+falls back to its built in default. The order hash printed identifies the ID
+order, which is also the slot order in fingerprint records (main/fingerprint.h).
+"""
+
+import argparse
+import os
+import struct
+import subprocess
+import sys
+
+NAMESPACE = "allowlist"
+KEY = "ids"
+NVS_SIZE = 0x6000           # partitions.csv
+MAX_IDS = 1024              # ALLOWLIST_MAX upper bound
+
+PARAMS_NAMESPACE = "params"
+PARAMS = {                  # s_defs in main/params.c, name: (nvs type, min, max)
+    "scan_interval": ("i32", 0x0004, 0x4000),
+    "scan_window": ("i32", 0x0004, 0x4000),
+    "cycle_ms": ("i32", 1000, 3600000),
+    "rx_ms": ("i32", 100, 60000),
+    "queue_len": ("i32", 1, None),      # up to BEACON_QUEUE_LEN, checked on the receiver
+    "device_id": ("i32", 0, 127),
+    "server": ("string", 1, 48),        # length, PARAM_STR_MAX
+}
+
+
+def order_hash(ids):
+    """FNV-1a over the IDs' little endian bytes, same as allowlist_order_hash()."""
+    h = 2166136261
+    for i in ids:
+        for byte in struct.pack("<I", i):
+            h = ((h ^ byte) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def id_key(id_bytes):
+    """Key of a full beacon ID, same as ble_id_hash() in main/beaconDecode.c."""
+    h = 2166136261
+    for (word,) in struct.iter_unpack("<I", id_bytes):
+        h = ((h ^ word) * 16777619) & 0xFFFFFFFF
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+    h ^= h >> 13
+    h = (h * 0xC2B2AE35) & 0xFFFFFFFF
+    h ^= h >> 16
+    return h
+
+
+def parse_id(text):
+    text = text.strip().lower().replace("-", "")
+    if text.startswith("0x"):
+        text = text[2:]
+    if len(text) == 8:
+        return int(text, 16)
+    if len(text) in (32, 40):
+        return id_key(bytes.fromhex(text))
+    raise ValueError("expected 8 hex digits or a 32/40 digit beacon ID, got %r" % text)
+
+
+def parse_param(text):
+    name, sep, value = text.partition("=")
+    if not sep or name not in PARAMS:
+        raise ValueError("expected one of %s=<value>, got %r" % (", ".join(PARAMS), text))
+    kind, low, high = PARAMS[name]
+    size = len(value) if kind == "string" else int(value, 0)
+    if size < low or (high is not None and size > high):
+        raise ValueError("%s out of bounds: %r" % (name, value))
+    if kind == "string" and any(c <= " " or c > "~" or c == "," for c in value):
+        raise ValueError("%s has characters the receiver rejects: %r" % (name, value))
+    return name, kind, value if kind == "string" else str(int(value, 0))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("ids", nargs="*", help="beacon keys (8 hex digits) or full IDs (32/40)")
+    parser.add_argument("--file", help="more IDs, one per line (# comments allowed)")
+    parser.add_argument("--param", action="append", default=[], metavar="NAME=VALUE",
+                        help="receiver parameter to keep in the image, repeat for each one")
+    parser.add_argument("--out", default="allowlist", help="output prefix (default allowlist)")
+    args = parser.parse_args()
+
+    texts = list(args.ids)
+    if args.file:
+        with open(args.file) as f:
+            texts += [line.split("#")[0] for line in f if line.split("#")[0].strip()]
+
+    try:
+        ids = sorted(set(parse_id(t) for t in texts))
+        params = dict((p[0], p) for p in map(parse_param, args.param))
+    except ValueError as err:
+        sys.exit(str(err))
+    if not ids or len(ids) > MAX_IDS:
+        sys.exit("need between 1 and %d IDs, got %d" % (MAX_IDS, len(ids)))
+
+    blob = b"".join(struct.pack("<I", i) for i in ids)
+    csv = args.out + ".csv"
+    with open(csv, "w") as f:
+        f.write("key,type,encoding,value\n")
+        f.write("%s,namespace,,\n" % NAMESPACE)
+        f.write("%s,data,hex2bin,%s\n" % (KEY, blob.hex()))
+        if params:
+            f.write("%s,namespace,,\n" % PARAMS_NAMESPACE)
+            for name, kind, value in params.values():
+                f.write("%s,data,%s,%s\n" % (name, kind, value))
+    print("%s: %d IDs, order hash %08x" % (csv, len(ids), order_hash(ids)))
+    if not params:
+        print("no --param given, the receiver's stored parameters are replaced by the defaults")
+
+    idf = os.environ.get("IDF_PATH")
+    if idf:
+        gen = os.path.join(idf, "components", "nvs_flash", "nvs_partition_generator", "nvs_partition_gen.py")
+        subprocess.check_call([sys.executable, gen, "generate", csv, args.out + ".bin", hex(NVS_SIZE)])
+    else:
+        print("IDF_PATH not set, run nvs_partition_gen.py on %s to get the partition image" % csv)
+
+
+if __name__ == "__main__":
+    main()
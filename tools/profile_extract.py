@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""Pulls the Chrome traces dumped by the cycle profiler (main/profile.c,
+PROFILE_CHROME_TRACE) out of a serial log.
+
+Each dump is written to its own file, open them in chrome://tracing or
+ui.perfetto.dev. tid is the core the span ran on.
+
+    idf.py monitor | tee monitor.log
+    python3 tools/profile_extract.py monitor.log --out trace
+"""
+
+import argparse
+import json
+import re
+import sys
+
+BEGIN = "--- chrome trace begin ---"
+END = "--- chrome trace end ---"
+
+# idf.py monitor may colour or prefix lines
+ANSI = re.compile(r"\x1b\[[0-9;]*m")
+
+
+def extract(lines):
+    """Yields the parsed JSON of every complete dump."""
+    body = None
+    for line in lines:
+        line = ANSI.sub("", line).strip()
+        if line.endswith(BEGIN):
+            body = []
+        elif line.endswith(END) and body is not None:
+            try:
+                yield json.loads("".join(body))
+            except ValueError as err:
+                print("skipping damaged trace: %s" % err, file=sys.stderr)
+            body = None
+        elif body is not None:
+            body.append(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", help="serial log, - for stdin")
+    parser.add_argument("--out", default="trace", help="output prefix (default trace)")
+    args = parser.parse_args()
+
+    log = sys.stdin if args.log == "-" else open(args.log, errors="replace")
+    count = 0
+    for count, trace in enumerate(extract(log), 1):
+        name = "%s_%d.json" % (args.out, count)
+        with open(name, "w") as f:
+            json.dump(trace, f)
+        print("%s: %d spans" % (name, len(trace["traceEvents"])))
+
+    if count == 0:
+        print("no traces found, is PROFILE_CHROME_TRACE enabled?", file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
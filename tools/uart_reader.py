@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Host reader for the UART upload transport (see main/uartSink.h).
+
+Reads the COBS framed record stream from a serial device or a pty, checks each
+frame's CRC and prints the records the same way tools/udp_collector.py does.
+Gaps in the frame sequence (frames dropped on the receiver) are reported.
+
+    python3 tools/uart_reader.py /dev/ttyUSB0 --baud 921600
+"""
+
+import argparse
+import os
+import struct
+import sys
+import termios
+import tty
+
+from udp_collector import parse_records
+
+VERSION = 1
+HEADER_LEN = 4
+CRC_LEN = 2
+
+BAUDS = {b: getattr(termios, "B%d" % b) for b in (115200, 230400, 460800, 500000, 576000, 921600,
+                                                   1000000, 1500000, 2000000, 3000000)
+         if hasattr(termios, "B%d" % b)}
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, same as crc16() in main/uartSink.c."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """Reverses cobs_encode in main/uartSink.c (without the 0x00 delimiter)."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("bad COBS block")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def decode_frame(encoded):
+    """Returns (deviceID, seq, record) or raises ValueError."""
+    frame = cobs_decode(encoded)
+    if len(frame) < HEADER_LEN + 1 + CRC_LEN:
+        raise ValueError("short frame")
+    (crc,) = struct.unpack_from("<H", frame, len(frame) - CRC_LEN)
+    if crc16(frame[:-CRC_LEN]) != crc:
+        raise ValueError("CRC mismatch")
+    version, device_id, seq = struct.unpack_from("<BbH", frame)
+    if version != VERSION:
+        raise ValueError("unknown version %d" % version)
+    return device_id, seq, frame[HEADER_LEN:-CRC_LEN]
+
+
+def open_port(path, baud):
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        if baud in BAUDS:
+            attrs = termios.tcgetattr(fd)
+            attrs[4] = attrs[5] = BAUDS[baud]
+            termios.tcsetattr(fd, termios.TCSANOW, attrs)
+        else:
+            print("baud %d not supported here, leaving the port as is" % baud, file=sys.stderr)
+    return fd
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("device", help="serial device or pty")
+    parser.add_argument("--baud", type=int, default=921600)
+    args = parser.parse_args()
+
+    fd = open_port(args.device, args.baud)
+    buf = bytearray()
+    last_seq = {}
+    bad = 0
+
+    while True:
+        chunk = os.read(fd, 4096)
+        if not chunk:
+            break
+        buf += chunk
+        while True:
+            end = buf.find(0)
+            if end < 0:
+                break
+            encoded = bytes(buf[:end])
+            del buf[:end + 1]
+            if not encoded:
+                continue
+            try:
+                device_id, seq, record = decode_frame(encoded)
+                # One record per frame, parse_records expects a count byte first
+                for _, fields in parse_records(bytes([1]) + record):
+                    print("deviceID=%d seq=%d %s" % (device_id, seq,
+                          " ".join("%s=%s" % kv for kv in fields.items())))
+            except (ValueError, IndexError, struct.error) as err:
+                # Resyncs on the next delimiter
+                bad += 1
+                print("bad frame (%d so far): %s" % (bad, err), file=sys.stderr)
+                continue
+            prev = last_seq.get(device_id)
+            if prev is not None and seq != (prev + 1) & 0xFFFF:
+                print("deviceID=%d lost %d frames" % (device_id, (seq - prev - 1) & 0xFFFF), file=sys.stderr)
+            last_seq[device_id] = seq
+            sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""Reference collector for the UDP upload transport (see main/udp.h).
+
+Receives sequenced datagrams from receivers, acknowledges every datagram with a
+selective ack covering the last 32 sequence numbers and prints each reading
+once, even if the receiver retransmits. With --max-rate the collector tells
+receivers to back off once the fleet as a whole exceeds the datagram rate.
+Each --set is pushed to the receivers in the acks (see main/params.h), they take
+effect at the start of the receiver's next scan cycle.
+
+    python3 tools/udp_collector.py --port 5001 --max-rate 200
+    python3 tools/udp_collector.py --set cycle_ms=10000 --set rx_ms=3000
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+MAGIC = b"FH"
+VERSION = 2
+HEADER_LEN = 10
+TYPE_DATA = 0x01
+TYPE_ACK = 0x02
+
+FLAG_COMPRESSED = 0x01          # data: payload is compress_lz output (main/compress.h)
+ACK_FLAG_COMPRESSION = 0x01     # ack: we accept compressed payloads
+ACK_FLAG_RETRY_AFTER = 0x02     # ack: u16 after the bitmap, hold off for that many 100 ms units
+ACK_FLAG_PARAMS = 0x04          # ack: rest of the datagram is "name=value,..."
+ACK_PARAMS_MAX = 128            # UDP_ACK_PARAMS_MAX in main/udp.c
+
+COMPRESS_MIN_MATCH = 3
+
+RECORD_TYPE_SIGHTING = 0x01
+RECORD_SIGHTING_LEN = 10
+RECORD_TYPE_PRESENCE = 0x02
+RECORD_PRESENCE_LEN = 11
+RECORD_TYPE_HISTOGRAM = 0x03
+RECORD_HISTOGRAM_HEADER_LEN = 11
+RECORD_TYPE_FINGERPRINT = 0x04
+RECORD_FINGERPRINT_HEADER_LEN = 8
+
+FORMATS = {1: "FH", 2: "iBeacon", 3: "Eddystone-UID", 4: "AltBeacon"}
+EVENTS = {1: "ENTER", 2: "EXIT", 3: "HEARTBEAT"}
+
+ACK_SPAN = 32
+
+
+class Device:
+    """Sequence numbers seen from one receiver boot (device ID + session)."""
+
+    def __init__(self):
+        self.seen = set()
+        self.highest = None
+
+    def mark(self, seq):
+        """Records seq, returns False if it was already seen."""
+        if seq in self.seen:
+            return False
+        self.seen.add(seq)
+        if self.highest is None or ((seq - self.highest) & 0xFFFF) < 0x8000:
+            self.highest = seq
+        # Only the ack span is kept, a retransmission older than that is printed again
+        self.seen = {s for s in self.seen if ((self.highest - s) & 0xFFFF) < ACK_SPAN}
+        return True
+
+    def bitmap(self, seq):
+        """Bit i acknowledges seq - i."""
+        bits = 0
+        for i in range(ACK_SPAN):
+            if ((seq - i) & 0xFFFF) in self.seen:
+                bits |= 1 << i
+        return bits
+
+
+class RateLimit:
+    """Token bucket over every receiver, one token per datagram."""
+
+    def __init__(self, rate):
+        self.rate = rate
+        self.tokens = rate
+        self.last = time.monotonic()
+
+    def take(self):
+        """Returns False once the fleet is over the rate."""
+        now = time.monotonic()
+        self.tokens = min(self.rate, self.tokens + (now - self.last) * self.rate)
+        self.last = now
+        if self.tokens < 1:
+            return False
+        self.tokens -= 1
+        return True
+
+
+def decompress_lz(data):
+    """Reverses compress_lz in main/compress.c."""
+    out = bytearray()
+    i = 0
+    flags = 0
+    bit = 8
+    while i < len(data):
+        if bit == 8:
+            flags = data[i]
+            i += 1
+            bit = 0
+            continue
+        if flags & (1 << bit):
+            out.append(data[i])
+            i += 1
+        else:
+            off = data[i] + 1
+            length = data[i + 1] + COMPRESS_MIN_MATCH
+            i += 2
+            if off > len(out):
+                raise ValueError("match offset out of range")
+            for _ in range(length):
+                out.append(out[-off])
+        bit += 1
+    return bytes(out)
+
+
+def parse_records(payload):
+    """Yields (type, fields) for every record in a data payload."""
+    count = payload[0]
+    off = 1
+    for _ in range(count):
+        rtype = payload[off]
+        if rtype == RECORD_TYPE_SIGHTING:
+            uuid, rssi, tx, group, fmt = struct.unpack_from("<4sbBHB", payload, off + 1)
+            yield rtype, {"uuid": uuid.hex(), "rssi": rssi, "txPower": tx, "pkGroup": group,
+                          "format": FORMATS.get(fmt, fmt)}
+            off += RECORD_SIGHTING_LEN
+        elif rtype == RECORD_TYPE_PRESENCE:
+            uuid, rssi, tx, group, fmt, event = struct.unpack_from("<4sbBHBB", payload, off + 1)
+            yield rtype, {"event": EVENTS.get(event, event), "uuid": uuid.hex(), "rssi": rssi,
+                          "txPower": tx, "pkGroup": group, "format": FORMATS.get(fmt, fmt)}
+            off += RECORD_PRESENCE_LEN
+        elif rtype == RECORD_TYPE_HISTOGRAM:
+            uuid, fmt, low, width, nbins, lo, hi = struct.unpack_from("<4sBbBBbb", payload, off + 1)
+            bins = struct.unpack_from("<%dH" % nbins, payload, off + RECORD_HISTOGRAM_HEADER_LEN)
+            yield rtype, {"histogram": uuid.hex(), "format": FORMATS.get(fmt, fmt), "low": low, "width": width,
+                          "min": lo, "max": hi, "samples": sum(bins), "bins": ",".join(map(str, bins))}
+            off += RECORD_HISTOGRAM_HEADER_LEN + 2 * nbins
+        elif rtype == RECORD_TYPE_FINGERPRINT:
+            group, slots, order = struct.unpack_from("<HBI", payload, off + 1)
+            off += RECORD_FINGERPRINT_HEADER_LEN
+            heard = payload[off:off + (slots + 7) // 8]
+            off += len(heard)
+            rssi = struct.unpack_from("<%db" % slots, payload, off)
+            off += slots
+            # Slot i is the i-th ID written by tools/allowlist.py, blank where not heard
+            yield rtype, {"fingerprint": group, "order": "%08x" % order, "slots": slots,
+                          "rssi": ",".join(str(r) if heard[i // 8] & (1 << (i % 8)) else "" for i, r in enumerate(rssi))}
+        else:
+            raise ValueError("unknown record type 0x%02x" % rtype)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=5001)
+    parser.add_argument("--no-compress", action="store_true",
+                        help="do not advertise support for compressed datagrams")
+    parser.add_argument("--max-rate", type=float, default=0,
+                        help="datagrams per second across all receivers before asking them to back off (0 = no limit)")
+    parser.add_argument("--retry-after", type=float, default=5,
+                        help="seconds a receiver holds off when over --max-rate")
+    parser.add_argument("--set", action="append", default=[], metavar="NAME=VALUE",
+                        help="parameter pushed to every receiver, repeatable")
+    args = parser.parse_args()
+    ack_flags = 0 if args.no_compress else ACK_FLAG_COMPRESSION
+    params = ",".join(args.set).encode("ascii")
+    if len(params) > ACK_PARAMS_MAX:
+        parser.error("--set values add up to more than %d bytes" % ACK_PARAMS_MAX)
+    if params:
+        ack_flags |= ACK_FLAG_PARAMS
+    limit = RateLimit(args.max_rate) if args.max_rate > 0 else None
+    retry_after = min(int(args.retry_after * 10), 0xFFFF)
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.host, args.port))
+    devices = {}
+
+    while True:
+        data, addr = sock.recvfrom(2048)
+        if len(data) < HEADER_LEN + 1 or data[:2] != MAGIC or data[2] != VERSION or data[3] != TYPE_DATA:
+            continue
+
+        device_id, flags, session, seq = struct.unpack_from("<bBHH", data, 4)
+        dev = devices.setdefault((device_id, session), Device())
+        fresh = dev.mark(seq)
+
+        # The datagram is still accepted, the receiver only slows down
+        if limit is not None and not limit.take():
+            ack = MAGIC + struct.pack("<BBbBHHIH", VERSION, TYPE_ACK, device_id, ack_flags | ACK_FLAG_RETRY_AFTER,
+                                      session, seq, dev.bitmap(seq), retry_after)
+        else:
+            ack = MAGIC + struct.pack("<BBbBHHI", VERSION, TYPE_ACK, device_id, ack_flags, session, seq, dev.bitmap(seq))
+        # Sent with every ack, the receiver ignores values it already has
+        sock.sendto(ack + params, addr)
+
+        if not fresh:
+            continue
+        try:
+            payload = data[HEADER_LEN:]
+            if flags & FLAG_COMPRESSED:
+                payload = decompress_lz(payload)
+            for _, fields in parse_records(payload):
+                print("deviceID=%d seq=%d %s" % (device_id, seq,
+                      " ".join("%s=%s" % kv for kv in fields.items())))
+        except (ValueError, IndexError, struct.error) as err:
+            print("bad datagram from %s: %s" % (addr[0], err), file=sys.stderr)
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()